@@ -1,20 +1,131 @@
-#include <iostream>
-#include <fstream>
-#include <ctime>
+#include <workload.hpp>
+#include <sort-io.hpp>
+#include <text-io.hpp>
+#include <thread-team.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
+namespace {
+    constexpr size_t blockSize = size_t{1} << 16;  // numbers generated and formatted by a thread at a time
+
+    /**!
+     * Parse a whole decimal number.
+     * @return whether the text is a number and nothing else
+     */
+    bool parseNumber(const char *text, uint64_t &value) {
+        char *end;
+        value = strtoull(text, &end, 10);
+        return *text != '\0' && *end == '\0';
+    }
+
+    /** Round
+     *  The blocks of one round of text output, one per thread
+     */
+    struct Round {
+        vector<vector<sort::Element>> numbers;
+        vector<vector<char>> text;
+        vector<size_t> bytes;
+
+        explicit Round(int threads) : numbers(threads, vector<sort::Element>(blockSize)),
+                                      text(threads, vector<char>(blockSize * sort::max_number_length)),
+                                      bytes(threads) {}
+    };
+}
+
 int main(int argc, char **argv) {
-    srand((int)time(0));
-    int n = atoi(argv[1]);
-    ofstream outFile(argv[2]);
-    int count = 1;
-    for (int i = 0; i < n; i++) {
-        outFile << rand() % RAND_MAX << " ";
-        if (count++ % 20 == 0) {
-            outFile << endl;
-        } 
+    if (argc < 3) {
+        cerr << "wrong arguments" << endl;
+        cerr << "usage: " << argv[0] << " <count> <output-file> [--distribution=uniform|sorted|reversed|nearly-sorted"
+             << "|few-unique|zipf|gaussian] [--seed=<n>] [--format=text|binary] [--threads=<n>]" << endl;
+        return 1;
+    }
+
+    uint64_t count;
+    if (!parseNumber(argv[1], count)) {
+        cerr << "invalid count: " << argv[1] << endl;
+        return 1;
+    }
+    const char *path = argv[2];
+    sort::Distribution distribution = sort::Distribution::Uniform;
+    uint64_t seed = 4005;
+    sort::Format format = sort::Format::Text;
+    int threads = static_cast<int>(max(thread::hardware_concurrency(), 1u));
+    for (int i = 3; i < argc; i++) {
+        if (strncmp(argv[i], "--distribution=", 15) == 0 && sort::parse_distribution(argv[i] + 15, distribution)) {
+            continue;
+        }
+        if (strncmp(argv[i], "--seed=", 7) == 0 && parseNumber(argv[i] + 7, seed)) {
+            continue;
+        }
+        if (strncmp(argv[i], "--format=", 9) == 0 && sort::parse_format(argv[i] + 9, format)) {
+            continue;
+        }
+        if (strncmp(argv[i], "--threads=", 10) == 0 && atoi(argv[i] + 10) > 0) {
+            threads = atoi(argv[i] + 10);
+            continue;
+        }
+        cerr << "unknown option: " << argv[i] << endl;
+        return 1;
+    }
+
+    // Every number depends on the seed and its index only, so the threads split the file
+    // any way and the output is the same for any number of threads
+    sort::ThreadTeam team(threads);
+    if (format == sort::Format::Binary) {
+        // Straight into the pages of the file, every thread its own slice
+        auto output = sort::MappedArray::create(path, count);
+        team.run([&](int id) {
+            size_t first = team.first(id, count);
+            size_t last = team.first(id + 1, count);
+            sort::generate(distribution, seed, count, first, output.begin() + first, output.begin() + last);
+            sort::to_little_endian(output.begin() + first, output.begin() + last);
+        });
+        return 0;
+    }
+
+    int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        cerr << "failed to create " << path << ": " << strerror(errno) << endl;
+        return 1;
+    }
+    // The threads format one round while the previous one is written out
+    Round rounds[2]{Round(threads), Round(threads)};
+    future<void> writing;
+    size_t roundSize = blockSize * threads;
+    for (size_t start = 0, r = 0; start < count; start += roundSize, r ^= 1) {
+        Round &round = rounds[r];
+        team.run([&](int id) {
+            size_t first = min(start + id * blockSize, count);
+            size_t numbers = min(blockSize, count - first);
+            sort::generate(distribution, seed, count, first, round.numbers[id].data(),
+                           round.numbers[id].data() + numbers);
+            char *text = round.text[id].data();
+            round.bytes[id] = sort::format_text(round.numbers[id].data(), round.numbers[id].data() + numbers, first,
+                                                text) - text;
+        });
+        if (writing.valid()) {
+            writing.get();
+        }
+        writing = async(launch::async, [&round, fd, path, threads] {
+            for (int id = 0; id < threads; id++) {
+                sort::write_all(fd, round.text[id].data(), round.bytes[id], path);
+            }
+        });
+    }
+    if (writing.valid()) {
+        writing.get();
     }
+    ::close(fd);
     return 0;
-}
\ No newline at end of file
+}
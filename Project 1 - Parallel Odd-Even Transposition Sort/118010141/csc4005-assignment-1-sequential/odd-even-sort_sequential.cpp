@@ -1,5 +1,5 @@
+#include <sort-io.hpp>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <chrono>
 #include <cstddef>
@@ -60,18 +60,10 @@ int main(int argc, char **argv) {
         return 0;
     }
     
-    Element element;
-    vector<Element> data;
-    ifstream input(argv[1]);
-    ofstream output(argv[2]);
-    while (input >> element) {
-        data.push_back(element);
-    }
+    vector<Element> data = sort::read_text(argv[1]);
     odd_even_sort(data.data(), data.data() + data.size());
     print_information(int(data.size()));
-    for (auto i : data) {
-        output << i << " ";
-    }
+    sort::write_text(argv[2], data.data(), data.data() + data.size());
 
 
 }
@@ -0,0 +1,36 @@
+#include <shared-sort.hpp>
+#include <sort-io.hpp>
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+using namespace std;
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cerr << "wrong arguments" << endl;
+        cerr << "usage: " << argv[0] << " <input-file> <output-file> [--engine=element|block] [--threads=<n>]" << endl;
+        return 0;
+    }
+
+    sort::SharedContext context;
+    for (int i = 3; i < argc; i++) {
+        if (strncmp(argv[i], "--engine=", 9) == 0 && sort::parse_engine(argv[i] + 9, context.engine)) {
+            continue;
+        }
+        if (strncmp(argv[i], "--threads=", 10) == 0) {
+            context.threads = atoi(argv[i] + 10);
+            continue;
+        }
+        cerr << "unknown option: " << argv[i] << endl;
+        return 0;
+    }
+
+    vector<sort::Element> data = sort::read_text(argv[1]);
+    auto info = context.shared_sort(data.data(), data.data() + data.size());
+    info->argc = argc;
+    info->argv.assign(argv, argv + argc);
+    sort::Context::print_information(*info, cout);
+    sort::write_text(argv[2], data.data(), data.data() + data.size());
+}
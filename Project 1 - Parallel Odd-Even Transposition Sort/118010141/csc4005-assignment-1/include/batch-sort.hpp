@@ -0,0 +1,34 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <sort-io.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sort {
+    /** BatchOptions
+     *  How batch_sort reads and writes its files
+     */
+    struct BatchOptions {
+        Format input_format = Format::Text;
+        Format output_format = Format::Text;
+    };
+
+    /**!
+     * Sort many files, in ascending order, as a pipeline: while all processes sort file k with
+     * mpi_sort, the root parses file k + 1 and writes file k - 1 on background threads, so the
+     * whole batch takes about the larger of its I/O and its sorting rather than their sum.
+     * MPI is only called from the calling thread. The root holds at most three files at once.
+     * Collective over context.comm; throws std::runtime_error on all processes if the root
+     * fails to read an input.
+     * @param context the context, its engine sorts every file
+     * @param inputs the files to sort, significant at the root
+     * @param outputs where to write each of them, significant at the root
+     * @param options file formats
+     * @return the information of every sort on the root, in input order; empty on the other processes
+     */
+    std::vector<std::unique_ptr<Information>> batch_sort(const Context &context, const std::vector<std::string> &inputs,
+                                                         const std::vector<std::string> &outputs,
+                                                         const BatchOptions &options);
+}
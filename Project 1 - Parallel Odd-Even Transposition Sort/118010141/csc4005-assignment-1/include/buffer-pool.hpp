@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <vector>
+
+namespace sort {
+    /** BufferPool
+     *  Scratch vectors that outlive a sort. A slot keeps its vector, and so its capacity,
+     *  from one call to the next: sorts of a size seen before allocate nothing. A slot holds
+     *  one element type at a time, asking for another type replaces its vector.
+     */
+    class BufferPool {
+    public:
+        enum Slot {
+            Local,  // a process's slice in mpi_sort
+            Bucket,  // what sample and radix sort hand back
+            Remote,  // the neighbour's block in block sort
+            Merged,  // merge-split output of block sort, the reordered elements of radix sort
+            Counts,  // elements per process in mpi_sort
+            Displs,  // offset of every process's slice in mpi_sort
+            Sizes,  // per-process counts the engines and the pre-pass gather
+            Ends,  // boundary elements: first and last of every slice, the element engine's trades
+            Histogram,  // digit counts of radix sort: local, global, on lower ranks, running offsets
+            Global,
+            Before,
+            Offsets,
+            Samples,  // pivot candidates of a selection or a sample sort: this process's, everyone's with their weights
+            Weighted,
+            Splitters,  // sample sort's splitters and, at the root, all samples they are picked from
+            AllSamples,
+            SendCounts,  // elements to and from every process in an all-to-all exchange, and their offsets
+            SendDispls,
+            RecvCounts,
+            RecvDispls,
+            NativeCounts,  // int counts and offsets of a native MPI collective
+            NativeDispls,
+            IntSendCounts,  // int copies of the counts and offsets collectives.hpp hands to the native MPI calls
+            IntSendDispls,
+            IntRecvCounts,
+            IntRecvDispls,
+            Segments,  // lengths of the segments a batch sorts locally: all of them at the root, this process's
+            LocalSegments,
+            LargeSegments,  // indices of the segments of a batch that all processes sort
+            Keys,  // the different keys of a counting sort in order and how often each occurs: all, this process's
+            KeyCounts,
+            LocalKeys,
+            LocalKeyCounts,
+        };
+
+        static constexpr size_t slot_count = LocalKeyCounts + 1;
+
+        /**!
+         * Get the vector of a slot. Its size and contents are left from the last use.
+         * @param slot the slot
+         * @return the vector, valid until the slot is asked for with another type or cleared
+         */
+        template<typename T>
+        std::vector<T> &get(Slot slot) {
+            Entry &entry = entries[slot];
+            if (entry.type != typeid(T)) {
+                entry.vector = std::make_shared<std::vector<T>>();
+                entry.type = typeid(T);
+                entry.capacity = [](const void *vector) {
+                    return static_cast<const std::vector<T> *>(vector)->capacity() * sizeof(T);
+                };
+            }
+            return *static_cast<std::vector<T> *>(entry.vector.get());
+        }
+
+        /**!
+         * @return bytes held by all slots
+         */
+        size_t bytes() const {
+            size_t total = 0;
+            for (const Entry &entry : entries) {
+                total += entry.vector ? entry.capacity(entry.vector.get()) : 0;
+            }
+            return total;
+        }
+
+        /**!
+         * Release the memory of all slots.
+         */
+        void clear() {
+            entries = {};
+        }
+
+    private:
+        struct Entry {
+            std::type_index type = typeid(void);
+            std::shared_ptr<void> vector;
+            size_t (*capacity)(const void *) = nullptr;
+        };
+
+        std::array<Entry, slot_count> entries{};
+    };
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <buffer-pool.hpp>
+#include <mpi.h>
+#include <cstddef>
+#include <vector>
+
+namespace sort {
+    class RequestCache;
+
+    /**
+     * Variable-count transfers with 64-bit counts and displacements (in elements).
+     *
+     * MPI counts are int. When every count and displacement of a call fits in chunk on all
+     * processes (one MPI_Allreduce of a flag), the native collective runs as is. Otherwise the
+     * transfer is split into point-to-point messages of at most chunk elements each, so
+     * nothing ever overflows. chunk is at most INT_MAX and must be the same on all processes.
+     * The int counts of the native collective are kept in the Int* slots of the caller's buffers.
+     */
+
+    /**!
+     * MPI_Scatterv with 64-bit counts.
+     * @param send the root's buffer, ignored on other processes
+     * @param counts elements for every process, significant at the root
+     * @param displs offset of every process's elements in send, significant at the root
+     * @param recv destination for recvCount elements
+     * @param recvCount number of elements this process receives
+     * @param type element datatype
+     * @param root rank of the root
+     * @param comm communicator
+     * @param chunk largest count of a single MPI call
+     * @param buffers scratch space of the caller
+     */
+    void scatterv(const void *send, const std::vector<size_t> &counts, const std::vector<size_t> &displs,
+                  void *recv, size_t recvCount, MPI_Datatype type, int root, MPI_Comm comm, size_t chunk,
+                  BufferPool &buffers);
+
+    /**!
+     * MPI_Gatherv with 64-bit counts.
+     * @param send this process's elements
+     * @param sendCount number of elements this process sends
+     * @param recv the root's buffer, ignored on other processes
+     * @param counts elements from every process, significant at the root
+     * @param displs offset of every process's elements in recv, significant at the root
+     * @param type element datatype
+     * @param root rank of the root
+     * @param comm communicator
+     * @param chunk largest count of a single MPI call
+     * @param buffers scratch space of the caller
+     */
+    void gatherv(const void *send, size_t sendCount, void *recv, const std::vector<size_t> &counts,
+                 const std::vector<size_t> &displs, MPI_Datatype type, int root, MPI_Comm comm, size_t chunk,
+                 BufferPool &buffers);
+
+    /**!
+     * MPI_Alltoallv with 64-bit counts.
+     * @param send source buffer
+     * @param sendCounts elements for every process
+     * @param sendDispls offset of every process's elements in send
+     * @param recv destination buffer
+     * @param recvCounts elements from every process
+     * @param recvDispls offset of every process's elements in recv
+     * @param type element datatype
+     * @param comm communicator
+     * @param chunk largest count of a single MPI call
+     * @param buffers scratch space of the caller
+     */
+    void alltoallv(const void *send, const std::vector<size_t> &sendCounts, const std::vector<size_t> &sendDispls,
+                   void *recv, const std::vector<size_t> &recvCounts, const std::vector<size_t> &recvDispls,
+                   MPI_Datatype type, MPI_Comm comm, size_t chunk, BufferPool &buffers);
+
+    /**!
+     * MPI_Sendrecv of a block whose size the receiver does not know in advance.
+     * @param send this process's elements
+     * @param sendCount number of elements sent
+     * @param recv destination, room for recvCapacity elements
+     * @param recvCapacity the most elements the partner may send, the same bound on both sides
+     * @param type element datatype
+     * @param partner rank of the partner
+     * @param tag message tag
+     * @param comm communicator
+     * @param chunk largest count of a single MPI call
+     * @param persistent persistent requests to start instead of an MPI_Sendrecv, null for none: the receive, and
+     *        the send when sendCount equals recvCapacity
+     * @return the number of elements received
+     */
+    size_t sendrecv(const void *send, size_t sendCount, void *recv, size_t recvCapacity, MPI_Datatype type,
+                    int partner, int tag, MPI_Comm comm, size_t chunk, RequestCache *persistent = nullptr);
+
+    /** RequestCache
+     *  Persistent point-to-point requests (MPI_Send_init, MPI_Recv_init), set up by the first
+     *  transfer of a kind and started again by every repetition of it: the same buffer, count,
+     *  type, peer, tag and communicator. A transfer that repeats every phase, or in every sort
+     *  of the same size, skips the request setup of MPI_Send and MPI_Recv. Requests must be
+     *  complete when the cache forgets them, and the cache must be cleared before MPI_Finalize.
+     */
+    class RequestCache {
+    public:
+        RequestCache() = default;
+
+        ~RequestCache();
+
+        RequestCache(const RequestCache &) = delete;
+
+        RequestCache &operator=(const RequestCache &) = delete;
+
+        /**!
+         * Get the persistent send of a buffer, set up on first use. Start it with MPI_Start.
+         * @param buffer the elements to send
+         * @param count number of elements, at most INT_MAX
+         * @param type element datatype
+         * @param peer rank of the receiver
+         * @param tag message tag
+         * @param comm communicator
+         * @return the inactive request
+         */
+        MPI_Request send(const void *buffer, size_t count, MPI_Datatype type, int peer, int tag, MPI_Comm comm);
+
+        /**!
+         * Get the persistent receive into a buffer, set up on first use. Start it with MPI_Start.
+         * @param buffer destination, room for count elements
+         * @param count the most elements to receive, at most INT_MAX
+         * @param type element datatype
+         * @param peer rank of the sender
+         * @param tag message tag
+         * @param comm communicator
+         * @return the inactive request
+         */
+        MPI_Request recv(void *buffer, size_t count, MPI_Datatype type, int peer, int tag, MPI_Comm comm);
+
+        /**!
+         * @return number of requests set up
+         */
+        size_t size() const;
+
+        /**!
+         * Free all requests.
+         */
+        void clear();
+
+    private:
+        struct Entry {
+            bool send;
+            const void *buffer;
+            size_t count;
+            MPI_Datatype type;
+            int peer;
+            int tag;
+            MPI_Comm comm;
+            MPI_Request request;
+        };
+
+        MPI_Request find(const Entry &key);
+
+        std::vector<Entry> entries;
+    };
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <sort-io.hpp>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace sort {
+    /** ExternalOptions
+     *  How external_sort reads, spills and writes
+     */
+    struct ExternalOptions {
+        size_t memory_limit = size_t{1} << 30;  // bytes the root holds at once, text buffers included
+        Format input_format = Format::Text;
+        Format output_format = Format::Text;
+        std::string temp_dir{};  // where sorted runs are spilled, empty for the system temporary directory
+    };
+
+    /**!
+     * Sort a file that may be larger than memory, in ascending order.
+     * Text files are read and written through chunks of a sixteenth of memory_limit per file
+     * (at most 12 MiB), and at least 96 KiB must be left for elements next to them.
+     * The root reads the input in chunks that fit in what is left together with the scratch
+     * space of mpi_sort, sorts every chunk with mpi_sort and spills it as a sorted run to a
+     * temporary file. The runs are then merged with a loser tree, as many at a time as there
+     * are read buffers of at least 32 KiB within memory_limit, in several passes if needed.
+     * A file that fits in one chunk is written out directly. Collective over context.comm; throws
+     * std::runtime_error on all processes if the root fails to read the input or to spill a run.
+     * @param context the context, its engine sorts the chunks
+     * @param input the file to sort, read on the root only
+     * @param output the file to write, written on the root only
+     * @param options memory limit, formats and temporary directory
+     * @return the information of the whole sort on the root, null on the other processes
+     */
+    std::unique_ptr<Information> external_sort(const Context &context, const char *input, const char *output,
+                                               const ExternalOptions &options);
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+/**
+ * SORT_INSTRUMENT (CMake option of the same name) switches the per-rank phase times of
+ * mpi_sort. At 0 the clock below is empty, every call on it is an inline no-op and no
+ * times are gathered, so nothing is left of it at run time.
+ */
+#ifndef SORT_INSTRUMENT
+#define SORT_INSTRUMENT 1
+#endif
+
+namespace sort {
+    /** Phase
+     *  Where a process spends the time of a sort
+     */
+    enum class Phase {
+        Compute,  // local sorts, merges and compare-exchange
+        Exchange,  // sending and receiving elements, samples and histograms between processes
+        Wait,  // synchronization: convergence checks, agreeing on sizes, the final barrier
+        Distribute,  // scatter from and gather to the root
+    };
+
+    constexpr size_t phase_count = 4;
+
+    using PhaseTimes = std::array<int64_t, phase_count>;  // ns spent in every phase, indexed by Phase
+
+    /**!
+     * Get the printable name of a phase.
+     * @param phase the phase
+     * @return the name, e.g. "exchange"
+     */
+    const char *phase_name(Phase phase);
+
+    /** PhaseClock
+     *  Charges the wall time of one thread to the phase it is in. Phases nest: entering
+     *  one stops the clock of the enclosing phase until it is left again.
+     */
+    class PhaseClock {
+    public:
+        /**!
+         * Zero all phases and start in Compute.
+         */
+        void reset() {
+#if SORT_INSTRUMENT
+            total = {};
+            current = Phase::Compute;
+            since = std::chrono::steady_clock::now();
+#endif
+        }
+
+        /**!
+         * Charge the time since the last switch to the current phase and switch to another.
+         * @param phase the phase from now on
+         * @return the phase before
+         */
+        Phase enter(Phase phase) {
+#if SORT_INSTRUMENT
+            auto now = std::chrono::steady_clock::now();
+            total[static_cast<size_t>(current)] += std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count();
+            since = now;
+            std::swap(current, phase);
+#endif
+            return phase;
+        }
+
+        /**!
+         * Charge the time since the last switch and read the totals.
+         * @return ns per phase, all zero without SORT_INSTRUMENT
+         */
+        PhaseTimes read() {
+#if SORT_INSTRUMENT
+            enter(current);
+            return total;
+#else
+            return {};
+#endif
+        }
+
+    private:
+#if SORT_INSTRUMENT
+        PhaseTimes total{};
+        Phase current = Phase::Compute;
+        std::chrono::steady_clock::time_point since{};
+#endif
+    };
+
+    /** PhaseScope
+     *  Enters a phase for the lifetime of the scope
+     */
+    class PhaseScope {
+    public:
+        PhaseScope(PhaseClock &clock, Phase phase) : clock(clock), previous(clock.enter(phase)) {}
+
+        ~PhaseScope() {
+            clock.enter(previous);
+        }
+
+        PhaseScope(const PhaseScope &) = delete;
+
+        PhaseScope &operator=(const PhaseScope &) = delete;
+
+    private:
+        PhaseClock &clock;
+        Phase previous;
+    };
+}
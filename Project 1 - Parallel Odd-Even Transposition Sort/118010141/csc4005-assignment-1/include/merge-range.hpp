@@ -0,0 +1,60 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace sort {
+    /**!
+     * Locate a position of the merge of two sorted arrays, equal elements of local first.
+     * Two processes merging the same blocks must pass them in the same order.
+     * @param local sorted local elements
+     * @param localCount number of local elements
+     * @param remote sorted remote elements
+     * @param remoteCount number of remote elements
+     * @param position number of merged elements, at most localCount + remoteCount
+     * @param compare the order
+     * @return how many of the first position merged elements come from local
+     */
+    template<typename T, typename Compare>
+    inline size_t merge_position(const T *local, size_t localCount, const T *remote, size_t remoteCount,
+                                 size_t position, Compare compare) {
+        size_t low = position > remoteCount ? position - remoteCount : 0;
+        size_t high = std::min(position, localCount);
+        while (low < high) {
+            size_t i = low + (high - low) / 2;
+            size_t j = position - i;
+            if (j > 0 && !compare(remote[j - 1], local[i])) {  // local[i] goes before remote[j - 1]
+                low = i + 1;
+            } else {
+                high = i;
+            }
+        }
+        return low;
+    }
+
+    /**!
+     * Merge two sorted arrays and keep the merged elements [first, last).
+     * The smallest count elements are [0, count), the largest are [total - count, total).
+     * @param local sorted local elements
+     * @param localCount number of local elements
+     * @param remote sorted remote elements
+     * @param remoteCount number of remote elements
+     * @param first first merged position to keep
+     * @param last past the last merged position to keep
+     * @param output destination for last - first elements
+     * @param compare the order
+     */
+    template<typename T, typename Compare>
+    inline void merge_range(const T *local, size_t localCount, const T *remote, size_t remoteCount,
+                            size_t first, size_t last, T *output, Compare compare) {
+        size_t i = merge_position(local, localCount, remote, remoteCount, first, compare);
+        size_t j = first - i;
+        for (size_t k = first; k < last; k++) {
+            if (j >= remoteCount || (i < localCount && !compare(remote[j], local[i]))) {
+                *output++ = local[i++];
+            } else {
+                *output++ = remote[j++];
+            }
+        }
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <vector>
+
+namespace sort {
+    /**!
+     * Read this process's slice of a binary file with collective MPI-IO. Rank r gets
+     * elements [r * n / size, (r + 1) * n / size), so no process reads the whole file.
+     * Collective over MPI_COMM_WORLD.
+     * @param path the file, raw little-endian int64
+     * @return the slice
+     */
+    std::vector<Element> mpi_read_binary(const char *path);
+
+    /**!
+     * Write the slices of all processes, concatenated in rank order, to a binary file
+     * with collective MPI-IO. Every process writes its slice at its own offset.
+     * Collective over MPI_COMM_WORLD.
+     * @param path the file, created or truncated
+     * @param local this process's slice, converted to little-endian in place
+     */
+    void mpi_write_binary(const char *path, std::vector<Element> &local);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <mpi.h>
+#include <cstddef>
+
+namespace sort {
+    /** MpiType
+     *  The MPI datatype of an element type, chosen at compile time.
+     *  There is no primary definition, so an unsupported type does not compile.
+     */
+    template<typename T>
+    struct MpiType;
+
+    template<>
+    struct MpiType<int32_t> {
+        static MPI_Datatype get() { return MPI_INT32_T; }
+    };
+
+    template<>
+    struct MpiType<uint32_t> {
+        static MPI_Datatype get() { return MPI_UINT32_T; }
+    };
+
+    template<>
+    struct MpiType<int64_t> {
+        static MPI_Datatype get() { return MPI_INT64_T; }
+    };
+
+    template<>
+    struct MpiType<uint64_t> {
+        static MPI_Datatype get() { return MPI_UINT64_T; }
+    };
+
+    template<>
+    struct MpiType<float> {
+        static MPI_Datatype get() { return MPI_FLOAT; }
+    };
+
+    template<>
+    struct MpiType<double> {
+        static MPI_Datatype get() { return MPI_DOUBLE; }
+    };
+
+    /**
+     * A record is a committed struct type of its two fields, resized to sizeof the record
+     * so that arrays of it keep their padding. Created on first use, after MPI_Init,
+     * and kept until MPI_Finalize.
+     */
+    template<typename Key, typename Value>
+    struct MpiType<KeyValue<Key, Value>> {
+        static MPI_Datatype get() {
+            static const MPI_Datatype type = [] {
+                using Record = KeyValue<Key, Value>;
+                int lengths[2] = {1, 1};
+                MPI_Aint displacements[2] = {offsetof(Record, key), offsetof(Record, value)};
+                MPI_Datatype types[2] = {MpiType<Key>::get(), MpiType<Value>::get()};
+                MPI_Datatype packed;
+                MPI_Datatype resized;
+                MPI_Type_create_struct(2, lengths, displacements, types, &packed);
+                MPI_Type_create_resized(packed, 0, sizeof(Record), &resized);
+                MPI_Type_commit(&resized);
+                MPI_Type_free(&packed);
+                return resized;
+            }();
+            return type;
+        }
+    };
+
+    /**!
+     * Get the MPI datatype of an element type.
+     * @return the datatype, committed if derived
+     */
+    template<typename T>
+    MPI_Datatype mpi_type() {
+        return MpiType<T>::get();
+    }
+}
@@ -4,9 +4,93 @@
 #include <cstddef>
 #include <chrono>
 #include <vector>
+#include <memory>
+#include <ostream>
+#include <functional>
+#include <climits>
+#include <mpi.h>
+#include <instrument.hpp>
+#include <buffer-pool.hpp>
 
 namespace sort {
-    using Element = int64_t;
+    class ThreadTeam;
+    class RequestCache;
+
+    using Element = int64_t;  // element type of the file formats and of the default mpi_sort
+
+    /** KeyValue
+     *  A fixed-size record ordered by its key only; the value travels with it
+     */
+    template<typename Key, typename Value>
+    struct KeyValue {
+        Key key;
+        Value value;
+
+        bool operator==(const KeyValue &other) const = default;
+
+        friend bool operator<(const KeyValue &first, const KeyValue &second) {
+            return first.key < second.key;
+        }
+
+        friend bool operator>(const KeyValue &first, const KeyValue &second) {
+            return first.key > second.key;
+        }
+    };
+
+    using KeyValue32 = KeyValue<int32_t, int32_t>;
+    using KeyValue64 = KeyValue<int64_t, int64_t>;
+
+    /**
+     * The element types the engines are compiled for, each with std::less and std::greater
+     * as the comparator. X is applied to every type, e.g. to instantiate a member template.
+     */
+#define SORT_FOR_EACH_TYPE(X) \
+    X(int32_t) X(uint32_t) X(int64_t) X(uint64_t) X(float) X(double) X(KeyValue32) X(KeyValue64)
+
+    /** Engine
+     *  The parallel algorithm used by mpi_sort
+     */
+    enum class Engine {
+        Element,  // trade a single element with the neighbour in every phase
+        Block,  // sort the local chunk once, then merge-split whole blocks with the neighbours
+        Sample,  // regular sampling sort: splitters from samples, one all-to-all bucket exchange
+        Radix,  // LSD radix sort: global digit histograms, one all-to-all redistribution per digit
+        Bitonic,  // bitonic merge-split over a hypercube of processes, Block when their number is not a power of two
+    };
+
+    /** SortPath
+     *  What mpi_sort did after measuring how sorted the input already is
+     */
+    enum class SortPath {
+        Engine,  // the engine alone, the input is not presorted enough (or Context::adaptive is off)
+        Presorted,  // nothing, the input was in order already
+        Adaptive,  // every slice sorted adaptively (natural merge or insertion), already in order across processes
+        AdaptiveEngine,  // every slice sorted adaptively, then the engine put the slices in order
+        Counting,  // few different keys: counted over all processes and written out, the engine did not run
+    };
+
+    /**!
+     * Get the printable name of a sort path.
+     * @param path the path
+     * @return the name, e.g. "adaptive+engine"
+     */
+    const char *sort_path_name(SortPath path);
+
+    /**!
+     * Get the printable name of an engine.
+     * @param engine the engine
+     * @return the name, e.g. "block"
+     */
+    const char *engine_name(Engine engine);
+
+    /**!
+     * Parse an engine name as printed by engine_name.
+     * @param name the name to parse
+     * @param engine output engine, untouched on failure
+     * @return whether the name is valid
+     */
+    bool parse_engine(const char *name, Engine &engine);
+
     /** Information
      *  The information for a single mpi run
      */
@@ -14,7 +98,14 @@ namespace sort {
         std::chrono::high_resolution_clock::time_point start{};
         std::chrono::high_resolution_clock::time_point end{};
         size_t length{};  // length of the array to be sorted
+        size_t element_size{};  // bytes per element
         int num_of_proc{};  // number of processes
+        int threads{};  // threads per process for local work
+        Engine engine{};  // the algorithm that ran
+        size_t phases{};  // odd-even phases actually executed
+        SortPath path{};  // what ran, see Context::adaptive
+        uint64_t descents{};  // adjacent inversions found by the pre-pass, a lower bound when the engine ran alone
+        std::vector<PhaseTimes> ranks{};  // time per phase of every process, empty without SORT_INSTRUMENT
         int argc{};
         std::vector<char *> argv{};  // Arguments
     };
@@ -22,6 +113,17 @@ namespace sort {
     struct Context {
         int argc;
         char **argv;
+        MPI_Comm comm = MPI_COMM_WORLD;  // processes that sort together, all of them must call mpi_sort
+        Engine engine = Engine::Block;  // algorithm used by mpi_sort, must agree on all processes
+        int check_interval = 0;  // phases between global convergence checks, 0 for the engine default, < 0 to disable
+        size_t chunk_limit = INT_MAX;  // largest count of a single MPI call, larger transfers are split
+        int threads = 1;  // threads per process for local phases and sorts, the same on all processes
+        bool adaptive = true;  // measure presortedness and distinct keys first, take a shorter path; the same on all processes
+        mutable std::unique_ptr<ThreadTeam> team;  // started on first use, restarted when threads changes
+        mutable PhaseClock clock;  // phase times of the running sort, on the thread that calls MPI
+        mutable BufferPool buffers;  // slices, blocks and counts kept from one sort to the next
+        mutable std::unique_ptr<RequestCache> requests;  // persistent neighbour exchanges, made on first use
+        mutable int cube_key = MPI_KEYVAL_INVALID;  // attribute that keeps the hypercube of a communicator
 
         Context(int &argc, char **&argv);
 
@@ -36,29 +138,387 @@ namespace sort {
         void swapE(Element* first, Element* second) const;
 
         /**!
-         * Odd sort process, sort from the first element
+         * Get the thread team for local work of a given size.
+         * @param work number of elements the team would work on
+         * @return the team, or null if threads is 1 or the work is too small to share
+         */
+        ThreadTeam *threadTeam(size_t work) const;
+
+        /**!
+         * Get the persistent requests of the neighbour exchanges, freed with the context.
+         * @return the cache
+         */
+        RequestCache &persistentRequests() const;
+
+        /**!
+         * Resolve the engine for a number of processes: Bitonic needs a power of two.
+         * @param size number of processes
+         * @return the engine that runs
+         */
+        Engine engineFor(int size) const;
+
+        /**!
+         * Get comm as a hypercube: a Cartesian communicator with one dimension of two per bit
+         * of the rank, ranks unchanged. Made by the first call on a communicator (collective then)
+         * and kept as an attribute of it until it is freed.
+         * @return the hypercube; comm must have a power of two processes, at least 2
+         */
+        MPI_Comm hypercube() const;
+
+        /**!
+         * Sort the local elements, split among the thread team if there is one.
+         * @param localArray local elements
+         * @param localCount number of local elements
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void localSort(T* localArray, size_t localCount, Compare compare) const;
+
+        /**!
+         * Odd sort process, sort from the first element.
+         * Runs the compare-exchange kernel for the element type, see sort-kernels.hpp.
          * @param localArray array to be odd sorted
          * @param localCount total numbers in the array
+         * @param compare the order, true if the first argument goes first
+         * @return whether any pair was swapped
          */
-        void oddSort(Element* localArray, int localCount) const;
+        template<typename T, typename Compare>
+        bool oddSort(T* localArray, size_t localCount, Compare compare) const;
 
         /**!
          * Even sort process, sort from the second element
          * @param localArray array to be odd sorted
          * @param localCount total numbers in the array
+         * @param compare the order, true if the first argument goes first
+         * @return whether any pair was swapped
          */
-        void evenSort(Element* localArray, int localCount) const;
+        template<typename T, typename Compare>
+        bool evenSort(T* localArray, size_t localCount, Compare compare) const;
 
         /**!
-         * Sort the elements in range [begin, end) in the ascending order.
+         * Resolve check_interval for an engine.
+         * @param defaultInterval interval used when check_interval is 0
+         * @return phases between convergence checks, at least 2, or 0 if disabled
+         */
+        int checkInterval(int defaultInterval) const;
+
+        /**!
+         * Every interval phases, check whether any process swapped during the batch.
+         * Collective when a check is due. Clears swapped for the next batch.
+         * @param swapped whether this process changed anything since the last check
+         * @param phases phases executed so far
+         * @param interval phases between checks, 0 to never check
+         * @return whether no process changed anything, i.e. the array is sorted
+         */
+        bool converged(bool &swapped, size_t phases, int interval) const;
+
+        /**!
+         * Element-wise odd-even transposition: totalCount phases, each trading at most
+         * one element with the neighbour process.
+         * @param localArray local elements
+         * @param localCount number of local elements
+         * @param totalCount number of elements over all processes
+         * @param compare the order
+         * @return the number of phases executed
+         */
+        template<typename T, typename Compare>
+        size_t elementSort(T* localArray, size_t localCount, size_t totalCount, Compare compare) const;
+
+        /**!
+         * Block odd-even transposition: sort the local chunk, then run one merge-split
+         * phase per process, exchanging whole blocks with the neighbours.
+         * @param localArray local elements, with room for blockCount elements
+         * @param localCount number of local elements, updated as blocks are split
+         * @param blockCount size of the largest block, the same on all processes
+         * @param compare the order
+         * @return the number of phases executed
+         */
+        template<typename T, typename Compare>
+        size_t blockSort(T* localArray, size_t &localCount, size_t blockCount, Compare compare) const;
+
+        /**!
+         * Merge-split with a partner: merge the two sorted blocks, both logically padded to
+         * blockCount with +inf, and keep the lower or the upper half. Both partners must
+         * order equal elements the same way, so exactly one of them passes localFirst.
+         * @param localArray local elements, sorted, with room for blockCount elements
+         * @param localCount number of local elements
+         * @param remote the partner's elements, sorted
+         * @param remoteCount number of the partner's elements
+         * @param blockCount size of the padded blocks
+         * @param localFirst whether equal local elements go before the partner's
+         * @param keepLower whether to keep the lower half
+         * @param merged scratch, room for blockCount elements
+         * @param compare the order
+         * @return the number of elements kept in localArray
+         */
+        template<typename T, typename Compare>
+        size_t mergeSplit(T* localArray, size_t localCount, const T *remote, size_t remoteCount, size_t blockCount,
+                          bool localFirst, bool keepLower, T *merged, Compare compare) const;
+
+        /**!
+         * Bitonic sort over the hypercube: sort the local block, then for every dimension d of
+         * log2(P) build bitonic sequences of 2^d blocks with d + 1 merge-split stages, each with
+         * the partner across one dimension. Always log2(P) (log2(P) + 1) / 2 stages, each a
+         * full-block exchange with a fixed partner. Needs a power of two processes.
+         * @param localArray local elements, with room for blockCount elements
+         * @param localCount number of local elements, updated as blocks are split
+         * @param blockCount size of the largest block, the same on all processes
+         * @param compare the order
+         * @return the number of stages executed
+         */
+        template<typename T, typename Compare>
+        size_t bitonicSort(T* localArray, size_t &localCount, size_t blockCount, Compare compare) const;
+
+        /**!
+         * Sample sort by regular sampling: sort locally, gather samples at the root,
+         * broadcast splitters, exchange buckets with MPI_Alltoallv and merge them.
+         * @param localArray local elements, sorted in place as a side effect
+         * @param localCount number of local elements
+         * @param bucket output, the sorted elements this process ends up with
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void sampleSort(T* localArray, size_t localCount, std::vector<T> &bucket, Compare compare) const;
+
+        /**!
+         * LSD radix sort over the bits of the keys, mapped so that their unsigned order is
+         * the order of compare. For every digit the histograms are combined with
+         * MPI_Allreduce and MPI_Exscan, which gives every element its global position,
+         * and the elements move there with MPI_Alltoallv. Digits shared by all keys are skipped.
+         * Only std::less and std::greater are supported.
+         * @param localArray local elements
+         * @param localCount number of local elements
+         * @param totalCount number of elements over all processes
+         * @param result output, the sorted elements this process ends up with
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void radixSort(T* localArray, size_t localCount, size_t totalCount, std::vector<T> &result,
+                       Compare compare) const;
+
+        /**!
+         * Count the descents (adjacent inversions) within all slices and between neighbouring
+         * slices, and choose a path. A slice whose runs average fewer than 32 elements stops
+         * counting early and sends the whole sort down the engine.
+         * @param localArray local elements
+         * @param localCount number of local elements
+         * @param compare the order
+         * @param localDescents output, the descents within this slice if counted to the end
+         * @param descents output, the descents found over all processes
+         * @return Presorted, Adaptive (sort the slices adaptively first) or Engine
+         */
+        template<typename T, typename Compare>
+        SortPath choosePath(const T *localArray, size_t localCount, Compare compare, size_t &localDescents,
+                            uint64_t &descents) const;
+
+        /**!
+         * Check whether every slice ends no later than the next non-empty one starts.
+         * @param localArray local elements, sorted
+         * @param localCount number of local elements
+         * @param compare the order
+         * @return the number of neighbouring slices out of order, the same on all processes
+         */
+        template<typename T, typename Compare>
+        uint64_t boundaryDescents(const T *localArray, size_t localCount, Compare compare) const;
+
+        /**!
+         * Estimate the number of different keys over all slices from random samples, with the
+         * Chao1 estimator: the keys seen plus f1 (f1 - 1) / (2 (f2 + 1)), where f1 keys were seen
+         * once and f2 twice. Collective, the same on all processes.
+         * @param localArray local elements
+         * @param localCount number of local elements
+         * @param compare the order
+         * @return the estimate
+         */
+        template<typename T, typename Compare>
+        uint64_t estimateDistinct(const T *localArray, size_t localCount, Compare compare) const;
+
+        /**!
+         * Counting sort for inputs with few different keys. If the estimate is small, every
+         * process counts the keys of its slice, the different keys are shared and the counts
+         * summed with MPI_Allreduce. Each process then writes its balanced share of the result,
+         * [rank * n / size, (rank + 1) * n / size), from the counts: no element moves between
+         * processes. The keys and counts stay in the buffers for writeCounted. Only for integral
+         * types, where equal keys are identical; it returns false for the others.
+         * @param local this process's slice, replaced by its share of the sorted array if counted
+         * @param totalCount number of elements over all processes
+         * @param compare the order
+         * @return whether the keys were counted, the same on all processes
+         */
+        template<typename T, typename Compare>
+        bool distinctKeySort(std::vector<T> &local, size_t totalCount, Compare compare) const;
+
+        /**!
+         * Write positions [from, to) of the array sorted by the last distinctKeySort.
+         * @param output destination for to - from elements
+         * @param from first position
+         * @param to past the last position
+         */
+        template<typename T>
+        void writeCounted(T *output, uint64_t from, uint64_t to) const;
+
+        /**!
+         * Run the selected engine over the slices held by all processes, after the
+         * presortedness and distinct key pre-passes if adaptive is set.
+         * @param local this process's slice, replaced by its part of the sorted array
+         * @param totalCount number of elements over all processes
+         * @param compare the order
+         * @param path output, what ran
+         * @param descents output, the descents found by the pre-pass
+         * @return the number of phases executed, 0 for engines without phases
+         */
+        template<typename T, typename Compare>
+        size_t distributedSort(std::vector<T> &local, size_t totalCount, Compare compare, SortPath &path,
+                               uint64_t &descents) const;
+
+        /**!
+         * Find the element at position k of the order of compare over the slices held by all
+         * processes, by distributed quickselect. Every round picks a pivot from samples weighted
+         * by the size of the slices they come from, partitions every slice three ways and
+         * keeps the part that holds position k, agreed with one MPI_Allreduce of the counts.
+         * Once few enough elements are left, they are gathered and finished at the root.
+         * @param local this process's slice, reordered
+         * @param totalCount number of elements over all processes
+         * @param k the position, below totalCount
+         * @param compare the order
+         * @param rounds output, the number of partitioning rounds
+         * @return the element, on all processes
+         */
+        template<typename T, typename Compare>
+        T distributedSelect(std::vector<T> &local, size_t totalCount, size_t k, Compare compare,
+                            size_t &rounds) const;
+
+        /**!
+         * Broadcast the number of elements at the root and scatter them in balanced slices:
+         * rank r gets [r * n / size, (r + 1) * n / size), sizes differ by at most one.
+         * @param begin the root's elements
+         * @param totalCount the number of elements, significant at the root, set on all processes
+         * @param local output, this process's slice
+         * @param counts output, the size of every slice
+         * @param displs output, the offset of every slice
+         */
+        template<typename T>
+        void scatterSlices(const T *begin, uint64_t &totalCount, std::vector<T> &local, std::vector<size_t> &counts,
+                           std::vector<size_t> &displs) const;
+
+        /**!
+         * The body of mpi_sort: scatter the root's elements in balanced slices, run the engine
+         * and gather the result back in place. Collective, leaves the information to the caller.
+         * @param begin the root's elements, sorted in place
+         * @param totalCount the number of elements, significant at the root
+         * @param compare the order
+         * @param path output, what ran
+         * @param descents output, the descents found by the pre-pass
+         * @return the number of phases executed
+         */
+        template<typename T, typename Compare>
+        size_t scatterSort(T *begin, uint64_t totalCount, Compare compare, SortPath &path, uint64_t &descents) const;
+
+        /**!
+         * Create the information of a run on the root process, with the clock started.
+         * @param rank rank of this process
+         * @param size number of processes
+         * @param length number of elements to sort
+         * @param elementSize bytes per element
+         * @return the information on the root, null on the other processes
+         */
+        std::unique_ptr<Information> newInformation(int rank, int size, size_t length, size_t elementSize) const;
+
+        /**!
+         * Stop the clock of a run and gather the phase times of all processes at the root.
+         * Collective unless SORT_INSTRUMENT is 0.
+         * @param information the information on the root, null on the other processes
+         * @param phases the number of phases executed
+         */
+        void finishInformation(Information *information, size_t phases) const;
+
+        /**!
+         * Sort the elements in range [begin, end) in the order of compare.
          * For sub-processes, null pointers will be passed. That is, the root process
          * should be in charge of sending the data to other processes.
+         * T and Compare must be the same on all processes; T is one of SORT_FOR_EACH_TYPE
+         * and Compare is std::less<T> or std::greater<T>.
+         * @param begin starting position
+         * @param end ending position
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the sorting
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> mpi_sort(T *begin, T *end, Compare compare = Compare()) const;
+
+        /**!
+         * Sort the elements in range [begin, end) in the ascending order.
+         * Sub-processes may pass null pointers without naming the element type.
          * @param begin starting position
          * @param end ending position
          * @return the information for the sorting
          */
         std::unique_ptr<Information> mpi_sort(Element *begin, Element *end) const;
 
+        /**!
+         * Sort many independent segments of one array in a single pass. Segments longer than
+         * both 64K elements and an even share of the whole array are sorted by all processes
+         * one after the other, as by mpi_sort. All the others are packed, cut into one run of
+         * whole segments per process, sent with one scatter, sorted where they land and
+         * collected with one gather. Sub-processes pass a null pointer and no offsets, e.g.
+         * mpi_sort_segments<T>(nullptr, {}, compare).
+         * @param data the root's elements, every segment sorted in place
+         * @param offsets at the root, where every segment starts, followed by the end of the last
+         *        one: segment i is [offsets[i], offsets[i + 1]), nondecreasing from 0
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the sorting on the root, null on the other processes;
+         *         its phases are those of the segments sorted by all processes
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> mpi_sort_segments(T *data, const std::vector<uint64_t> &offsets,
+                                                       Compare compare = Compare()) const;
+
+        /**!
+         * Find the element that would be at position k if [begin, end) were sorted, like
+         * std::nth_element, without sorting: the slices are scattered and selected from in
+         * place, only a few thousand elements ever come back to the root. Sub-processes pass
+         * null pointers, e.g. mpi_select<T>(nullptr, nullptr, 0, selected, compare).
+         * Throws std::runtime_error on all processes if k is not below the number of elements.
+         * @param begin starting position, the range is left unchanged
+         * @param end ending position
+         * @param k the position, significant at the root
+         * @param selected output, the element, on all processes
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the selection on the root, null on the other processes;
+         *         its phases are the partitioning rounds
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> mpi_select(const T *begin, const T *end, size_t k, T &selected,
+                                                Compare compare = Compare()) const;
+
+        /**!
+         * Get the first k elements of the order of compare, in order: the element at position
+         * k - 1 is selected as in mpi_select, and only the elements before it, and as many
+         * equal ones as needed, are gathered and sorted at the root. Sub-processes pass null
+         * pointers. A k past the number of elements takes them all.
+         * @param begin starting position, the range is left unchanged
+         * @param end ending position
+         * @param k the number of elements, significant at the root
+         * @param output the elements at the root, empty on the other processes
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the selection on the root, null on the other processes
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> mpi_topk(const T *begin, const T *end, size_t k, std::vector<T> &output,
+                                              Compare compare = Compare()) const;
+
+        /**!
+         * Sort an array that is already distributed: every process passes its own slice
+         * (of any size) and gets back its part of the result. The parts, concatenated in
+         * rank order, are the sorted array; their sizes depend on the engine.
+         * Nothing passes through the root.
+         * @param local this process's slice, replaced by its part of the sorted array
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the sorting on the root, null on the other processes
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> mpi_sort_distributed(std::vector<T> &local, Compare compare = Compare()) const;
+
         /*!
          * Print out the information.
          * @param info information struct
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace sort {
+    /**
+     * Sorting records of any size by a key, and argsort.
+     *
+     * Only (key, index) pairs travel: the root packs every key into a KeyValue64 with the
+     * record's index, the pairs are sorted with Context::mpi_sort, and the indices in the
+     * sorted order are the permutation. Payloads never leave the root; they are moved once,
+     * at the end, or the permutation is handed to the caller. Records with equal keys end
+     * up in an unspecified order. Keys are integers of at most 64 bits, float or double,
+     * ordered by std::less or std::greater.
+     */
+
+    /**!
+     * Map a key to an int64_t whose order is the order of compare on the keys.
+     * NaN keys, which compare does not order, still get a place: a NaN with the sign bit
+     * clear maps after +infinity and one with it set before -infinity (the other way round
+     * for std::greater), so they end up at the ends of the sorted order instead of in between.
+     * @param key the key
+     * @param compare std::less<Key> or std::greater<Key>, only its type is used
+     * @return the mapped key
+     */
+    template<typename Key, typename Compare>
+    int64_t ordered_key(Key key, Compare) {
+        static_assert(std::is_arithmetic_v<Key> && sizeof(Key) <= sizeof(int64_t), "keys are numbers of 64 bits at most");
+        static_assert(std::is_same_v<Compare, std::less<Key>> || std::is_same_v<Compare, std::greater<Key>>,
+                      "keys are ordered by std::less or std::greater");
+        constexpr uint64_t sign = uint64_t{1} << 63;
+        uint64_t bits;  // unsigned order is the ascending order of the keys
+        if constexpr (std::is_floating_point_v<Key>) {
+            auto raw = std::bit_cast<uint64_t>(static_cast<double>(key));  // floats widen exactly
+            bits = (raw & sign) ? ~raw : raw | sign;
+        } else if constexpr (std::is_signed_v<Key>) {
+            bits = static_cast<uint64_t>(static_cast<int64_t>(key)) ^ sign;
+        } else {
+            bits = static_cast<uint64_t>(key);
+        }
+        if constexpr (std::is_same_v<Compare, std::greater<Key>>) {
+            bits = ~bits;
+        }
+        return static_cast<int64_t>(bits ^ sign);
+    }
+
+    /**!
+     * Compute the permutation that sorts count keys given by a function of the index.
+     * Collective over context.comm; other processes pass a count of 0.
+     * @param context the context, its engine sorts the pairs
+     * @param count number of keys, significant at the root
+     * @param keyOf returns the key of an index
+     * @param permutation output at the root, position i of the sorted order holds
+     *        the element at index permutation[i]
+     * @param compare the order of the keys
+     * @return the information for the sorting on the root, null on the other processes
+     */
+    template<typename Key, typename Compare = std::less<Key>, typename KeyOf>
+    std::unique_ptr<Information> mpi_argsort_by(const Context &context, size_t count, KeyOf keyOf,
+                                                std::vector<uint64_t> &permutation, Compare compare = Compare()) {
+        std::vector<KeyValue64> pairs(count);
+        for (size_t i = 0; i < count; i++) {
+            pairs[i] = {ordered_key<Key>(keyOf(i), compare), static_cast<int64_t>(i)};
+        }
+        auto information = context.mpi_sort<KeyValue64>(pairs.data(), pairs.data() + count);
+        permutation.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            permutation[i] = static_cast<uint64_t>(pairs[i].value);
+        }
+        return information;
+    }
+
+    /**!
+     * Compute the permutation that sorts an array of keys. Sub-processes pass null pointers,
+     * e.g. mpi_argsort<double>(context, nullptr, nullptr, permutation).
+     * @param context the context
+     * @param begin first key
+     * @param end past the last key
+     * @param permutation output at the root, see mpi_argsort_by
+     * @param compare the order of the keys
+     * @return the information for the sorting on the root, null on the other processes
+     */
+    template<typename Key, typename Compare = std::less<Key>>
+    std::unique_ptr<Information> mpi_argsort(const Context &context, const Key *begin, const Key *end,
+                                             std::vector<uint64_t> &permutation, Compare compare = Compare()) {
+        return mpi_argsort_by<Key>(context, end - begin, [&](size_t i) { return begin[i]; }, permutation, compare);
+    }
+
+    /**!
+     * Compute the permutation that sorts records by a key field. Sub-processes pass null
+     * pointers, e.g. mpi_argsort<Record>(context, nullptr, nullptr, &Record::key, permutation).
+     * @param context the context
+     * @param begin first record
+     * @param end past the last record
+     * @param key the key field
+     * @param permutation output at the root, see mpi_argsort_by
+     * @param compare the order of the keys
+     * @return the information for the sorting on the root, null on the other processes
+     */
+    template<typename Record, typename Key, typename Compare = std::less<Key>>
+    std::unique_ptr<Information> mpi_argsort(const Context &context, const Record *begin, const Record *end,
+                                             Key Record::*key, std::vector<uint64_t> &permutation,
+                                             Compare compare = Compare()) {
+        return mpi_argsort_by<Key>(context, end - begin, [&](size_t i) { return begin[i].*key; }, permutation,
+                                   compare);
+    }
+
+    /**!
+     * Reorder an array by a permutation in place, following its cycles, so that position i
+     * receives the element that was at permutation[i]. Every element moves once.
+     * @param begin first element
+     * @param permutation the permutation, of the array's size
+     */
+    template<typename T>
+    void apply_permutation(T *begin, const std::vector<uint64_t> &permutation) {
+        std::vector<bool> done(permutation.size());
+        for (size_t start = 0; start < permutation.size(); start++) {
+            if (done[start]) {
+                continue;
+            }
+            T saved = std::move(begin[start]);
+            size_t i = start;
+            while (true) {
+                size_t from = permutation[i];
+                done[i] = true;
+                if (from == start) {
+                    begin[i] = std::move(saved);
+                    break;
+                }
+                begin[i] = std::move(begin[from]);
+                i = from;
+            }
+        }
+    }
+
+    /**!
+     * Sort records by a key field. Only keys and indices are sent to the other processes,
+     * the records are moved once, on the root. Sub-processes pass null pointers, e.g.
+     * mpi_sort_records<Record>(context, nullptr, nullptr, &Record::key).
+     * @param context the context
+     * @param begin first record
+     * @param end past the last record
+     * @param key the key field
+     * @param compare the order of the keys
+     * @return the information for the sorting on the root, null on the other processes
+     */
+    template<typename Record, typename Key, typename Compare = std::less<Key>>
+    std::unique_ptr<Information> mpi_sort_records(const Context &context, Record *begin, Record *end,
+                                                  Key Record::*key, Compare compare = Compare()) {
+        std::vector<uint64_t> permutation;
+        auto information = mpi_argsort(context, static_cast<const Record *>(begin), static_cast<const Record *>(end),
+                                       key, permutation, compare);
+        if (information) {
+            apply_permutation(begin, permutation);
+            information->end = std::chrono::high_resolution_clock::now();
+        }
+        return information;
+    }
+}
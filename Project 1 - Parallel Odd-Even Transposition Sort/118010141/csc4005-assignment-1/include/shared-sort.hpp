@@ -0,0 +1,58 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <thread-team.hpp>
+
+namespace sort {
+    /** SharedContext
+     *  Odd-even transposition sort on one node with threads instead of processes,
+     *  no MPI involved. The array is cut into one partition per thread, with partition
+     *  boundaries on cache lines, and the threads run the phases in lockstep.
+     */
+    struct SharedContext {
+        Engine engine = Engine::Block;  // Element or Block
+        int threads = 0;  // number of threads, 0 for one per hardware thread
+        mutable std::unique_ptr<ThreadTeam> team;  // started on first use, restarted when threads changes
+
+        /**!
+         * Sort the elements in range [begin, end) in the order of compare.
+         * Takes the same element types and orders as Context::mpi_sort.
+         * @param begin starting position
+         * @param end ending position
+         * @param compare the order, true if the first argument goes first
+         * @return the information for the sorting, with num_of_proc 1
+         */
+        template<typename T, typename Compare = std::less<T>>
+        std::unique_ptr<Information> shared_sort(T *begin, T *end, Compare compare = Compare()) const;
+
+        /**!
+         * Element-wise phases: every thread compare-exchanges the pairs of its partition,
+         * then the pair across its upper boundary, and waits for the others.
+         * @param array the elements
+         * @param count number of elements
+         * @param bounds partition boundaries, one more than the threads
+         * @param compare the order
+         * @return the number of phases executed
+         */
+        template<typename T, typename Compare>
+        size_t elementSort(T *array, size_t count, const std::vector<size_t> &bounds, Compare compare) const;
+
+        /**!
+         * Merge-split phases: every thread sorts its partition, then neighbouring partitions
+         * merge-split, each thread writing its half into its own spare buffer.
+         * @param array the elements
+         * @param count number of elements
+         * @param bounds partition boundaries, one more than the threads
+         * @param compare the order
+         * @return the number of phases executed
+         */
+        template<typename T, typename Compare>
+        size_t blockSort(T *array, size_t count, const std::vector<size_t> &bounds, Compare compare) const;
+
+        /**!
+         * Get the team, started with the configured number of threads.
+         * @return the team
+         */
+        ThreadTeam &threadTeam() const;
+    };
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <bit>
+#include <cstddef>
+#include <vector>
+
+namespace sort {
+    /** Format
+     *  On-disk layout of an array of elements
+     */
+    enum class Format {
+        Text,  // whitespace separated decimal numbers, as written by generateNum
+        Binary,  // raw little-endian int64, 8 bytes per element, no header
+    };
+
+    /**!
+     * Get the printable name of a format.
+     * @param format the format
+     * @return the name, e.g. "binary"
+     */
+    const char *format_name(Format format);
+
+    /**!
+     * Parse a format name as printed by format_name.
+     * @param name the name to parse
+     * @param format output format, untouched on failure
+     * @return whether the name is valid
+     */
+    bool parse_format(const char *name, Format &format);
+
+    /**!
+     * Convert elements between host and little-endian byte order, in place.
+     * A no-op on little-endian hosts.
+     * @param begin first element
+     * @param end past the last element
+     */
+    inline void to_little_endian(Element *begin, Element *end) {
+        if constexpr (std::endian::native != std::endian::little) {
+            for (auto i = begin; i != end; ++i) {
+                auto value = static_cast<uint64_t>(*i);
+                uint64_t swapped = 0;
+                for (int byte = 0; byte < 8; byte++) {
+                    swapped = (swapped << 8) | ((value >> (byte * 8)) & 0xff);
+                }
+                *i = static_cast<Element>(swapped);
+            }
+        }
+    }
+
+    /** MappedArray
+     *  An array of elements backed by a memory-mapped binary file
+     */
+    struct MappedArray {
+        Element *data = nullptr;
+        size_t length = 0;  // number of elements
+
+        MappedArray() = default;
+
+        MappedArray(MappedArray &&other) noexcept;
+
+        MappedArray &operator=(MappedArray &&other) noexcept;
+
+        ~MappedArray();
+
+        /**!
+         * Map a binary file for reading. The mapping is private: writes (e.g. sorting in
+         * place) stay in memory and never reach the file.
+         * @param path the file
+         * @return the mapping
+         */
+        static MappedArray open(const char *path);
+
+        /**!
+         * Create or truncate a binary file of length elements and map it for writing.
+         * @param path the file
+         * @param length number of elements
+         * @return the mapping, flushed to the file when destroyed
+         */
+        static MappedArray create(const char *path, size_t length);
+
+        Element *begin() const { return data; }
+
+        Element *end() const { return data + length; }
+    };
+
+    /**!
+     * Read all numbers of a text file.
+     * @param path the file
+     * @return the numbers
+     */
+    std::vector<Element> read_text(const char *path);
+
+    /**!
+     * Write numbers as text, 20 per line.
+     * @param path the file
+     * @param begin first element
+     * @param end past the last element
+     */
+    void write_text(const char *path, const Element *begin, const Element *end);
+
+    /**!
+     * Write numbers as raw little-endian int64 through a pre-sized mapping.
+     * @param path the file
+     * @param begin first element
+     * @param end past the last element
+     */
+    void write_binary(const char *path, const Element *begin, const Element *end);
+}
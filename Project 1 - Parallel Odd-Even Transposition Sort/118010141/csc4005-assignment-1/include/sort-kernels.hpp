@@ -0,0 +1,77 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+
+namespace sort {
+    /** Kernel
+     *  Implementation of the local compare-exchange step
+     */
+    enum class Kernel {
+        Scalar,  // branchless min/max, one pair at a time
+        AVX2,  // 2 pairs per 256-bit vector, compare + blend
+        AVX512,  // 4 pairs per 512-bit vector, native 64-bit min/max
+    };
+
+    /**!
+     * Get the printable name of a kernel.
+     * @param kernel the kernel
+     * @return the name, e.g. "avx2"
+     */
+    const char *kernel_name(Kernel kernel);
+
+    /**!
+     * Check whether the CPU can run a kernel.
+     * @param kernel the kernel
+     * @return whether it is supported by both the build and the CPU
+     */
+    bool kernel_supported(Kernel kernel);
+
+    /**!
+     * The fastest kernel the CPU supports, detected once.
+     * @return the kernel
+     */
+    Kernel best_kernel();
+
+    /**!
+     * Compare-exchange the pairs (0, 1), (2, 3), ... so that the smaller element of every
+     * pair comes first. An odd last element is left alone.
+     * @param kernel implementation to use, must be supported
+     * @param array the elements
+     * @param count number of elements
+     * @return whether any pair was swapped
+     */
+    bool compare_exchange(Kernel kernel, Element *array, size_t count);
+
+    /**!
+     * compare_exchange with the best kernel for this CPU.
+     */
+    bool compare_exchange(Element *array, size_t count);
+
+    /**!
+     * compare_exchange for any element type and order: branchless, one pair at a time.
+     * @param array the elements
+     * @param count number of elements
+     * @param compare the order, true if the first argument goes first
+     * @return whether any pair was swapped
+     */
+    template<typename T, typename Compare>
+    bool compare_exchange(T *array, size_t count, Compare compare) {
+        bool swapped = false;
+        for (size_t j = 0; j + 1 < count; j += 2) {
+            T first = array[j];
+            T second = array[j + 1];
+            bool inverted = compare(second, first);
+            swapped |= inverted;
+            array[j] = inverted ? second : first;
+            array[j + 1] = inverted ? first : second;
+        }
+        return swapped;
+    }
+
+    /**!
+     * The ascending int64 order takes the vector kernels.
+     */
+    inline bool compare_exchange(Element *array, size_t count, std::less<Element>) {
+        return compare_exchange(array, count);
+    }
+}
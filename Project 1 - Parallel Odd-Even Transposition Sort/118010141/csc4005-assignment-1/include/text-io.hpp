@@ -0,0 +1,96 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <cstddef>
+#include <memory>
+
+namespace sort {
+    constexpr size_t text_chunks_in_flight = 3;  // chunks a TextReader or a TextWriter holds, of chunkSize bytes each
+    constexpr size_t max_number_length = 24;  // bytes format_text may take per number, "-9223372036854775808 \n" fits
+
+    /**!
+     * Format numbers in the text format: every number followed by a space, a line break
+     * after every 20th number of the file.
+     * @param begin first number
+     * @param end past the last number
+     * @param first index of the first number in the file, where the line breaks fall
+     * @param output room for (end - begin) * max_number_length bytes
+     * @return past the last byte written
+     */
+    char *format_text(const Element *begin, const Element *end, size_t first, char *output);
+
+    /**!
+     * Write a whole buffer to a file descriptor, retrying interrupted and partial writes.
+     * Throws std::runtime_error naming the file if a write fails.
+     * @param fd the file descriptor
+     * @param data the bytes
+     * @param bytes number of bytes
+     * @param path the file, for the error message
+     */
+    void write_all(int fd, const void *data, size_t bytes, const char *path);
+
+    /** TextReader
+     *  Streaming parser for whitespace separated integers. A background thread reads the
+     *  file chunk by chunk while the caller parses the chunk before it, so reading and
+     *  parsing overlap and memory stays at a few chunks whatever the file size.
+     */
+    class TextReader {
+    public:
+        /**!
+         * Open a file and start reading it in the background.
+         * @param path the file
+         * @param chunkSize bytes per read
+         */
+        explicit TextReader(const char *path, size_t chunkSize = size_t{1} << 22);
+
+        ~TextReader();
+
+        /**!
+         * Parse the next numbers.
+         * @param output destination for at most count numbers
+         * @param count capacity of output
+         * @return the number of numbers parsed, less than count only at the end of the file
+         */
+        size_t read(Element *output, size_t count);
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+    };
+
+    /** TextWriter
+     *  Streaming formatter producing the text format: every number followed by a space,
+     *  a line break after every 20 numbers. Numbers are formatted into a chunk while a
+     *  background thread writes out the previous one.
+     */
+    class TextWriter {
+    public:
+        /**!
+         * Create or truncate a file and start the background writer.
+         * @param path the file
+         * @param chunkSize bytes per write
+         */
+        explicit TextWriter(const char *path, size_t chunkSize = size_t{1} << 22);
+
+        /**!
+         * Flush and close, errors are dropped; call close() to see them.
+         */
+        ~TextWriter();
+
+        /**!
+         * Append numbers.
+         * @param begin first element
+         * @param end past the last element
+         */
+        void write(const Element *begin, const Element *end);
+
+        /**!
+         * Flush everything and close the file.
+         */
+        void close();
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+    };
+}
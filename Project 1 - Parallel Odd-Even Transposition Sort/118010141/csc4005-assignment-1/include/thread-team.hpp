@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+namespace sort {
+    /** ThreadTeam
+     *  A fixed team of threads that run the same task together, one call per phase.
+     *  The caller is member 0, so MPI calls made by member 0 come from the thread that
+     *  initialized MPI. The other members are started once and sleep between tasks.
+     */
+    class ThreadTeam {
+    public:
+        /**!
+         * Start the team.
+         * @param size number of members, the caller included, at least 1
+         */
+        explicit ThreadTeam(int size);
+
+        ~ThreadTeam();
+
+        /**!
+         * @return number of members, the caller included
+         */
+        int size() const;
+
+        /**!
+         * Run task(id) on every member, id 0 on the calling thread, and wait for all of them.
+         * The first exception thrown by a member is rethrown here.
+         * @param task the work of one member
+         */
+        void run(const std::function<void(int)> &task);
+
+        /**!
+         * Split [0, count) evenly among the members.
+         * @param id member
+         * @param count number of items
+         * @return the first item of the member; the member ends where member id + 1 starts
+         */
+        size_t first(int id, size_t count) const;
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+    };
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <odd-even-sort.hpp>
+#include <cstddef>
+#include <cstdint>
+
+namespace sort {
+    /** Distribution
+     *  Shape of a generated input
+     */
+    enum class Distribution {
+        Uniform,  // independent keys in [0, 2^31 - 1), like generateNum
+        Sorted,  // ascending
+        Reversed,  // descending
+        NearlySorted,  // ascending, with about 1% of the keys moved a short distance
+        FewUnique,  // uniform over 16 distinct keys
+        Zipf,  // key k in [1, 2^31 - 1) with probability about k^-1.2: a few keys are very frequent
+        Gaussian,  // normal around 2^30 with a standard deviation of 2^27, clamped to [0, 2^31 - 1)
+    };
+
+    /**!
+     * Get the printable name of a distribution.
+     * @param distribution the distribution
+     * @return the name, e.g. "nearly-sorted"
+     */
+    const char *distribution_name(Distribution distribution);
+
+    /**!
+     * Parse a distribution name as printed by distribution_name.
+     * @param name the name to parse
+     * @param distribution output distribution, untouched on failure
+     * @return whether the name is valid
+     */
+    bool parse_distribution(const char *name, Distribution &distribution);
+
+    /**!
+     * Generate elements [first, first + (end - begin)) of an input of count elements.
+     * Every element depends only on the seed and its index, so slices can be generated
+     * independently, in any order, and always give the same input.
+     * @param distribution shape of the input
+     * @param seed the seed
+     * @param count number of elements of the whole input
+     * @param first index of begin in the whole input
+     * @param begin destination
+     * @param end past the last destination
+     */
+    void generate(Distribution distribution, uint64_t seed, size_t count, size_t first, Element *begin, Element *end);
+}
@@ -0,0 +1,141 @@
+#include <batch-sort.hpp>
+#include <mpi.h>
+#include <unistd.h>
+#include <exception>
+#include <future>
+#include <stdexcept>
+#include <utility>
+
+#define MASTER 0
+
+namespace sort {
+    namespace {
+        /** LoadedFile
+         *  The elements of one input: a private mapping of a binary file or the numbers of a text file
+         */
+        struct LoadedFile {
+            MappedArray mapped;
+            std::vector<Element> parsed;
+
+            Element *begin() {
+                return mapped.data != nullptr ? mapped.begin() : parsed.data();
+            }
+
+            Element *end() {
+                return mapped.data != nullptr ? mapped.end() : parsed.data() + parsed.size();
+            }
+        };
+
+        /**!
+         * Read an input completely, so that sorting it touches memory only.
+         * @param path the file
+         * @param format its format
+         * @return the elements
+         */
+        LoadedFile load(const std::string &path, Format format) {
+            LoadedFile file;
+            if (format == Format::Text) {
+                file.parsed = read_text(path.c_str());
+                return file;
+            }
+            file.mapped = MappedArray::open(path.c_str());
+            // Fault every page in for writing here, or the scatter would read the file and copy the pages
+            auto *bytes = reinterpret_cast<volatile char *>(file.mapped.data);
+            size_t page = sysconf(_SC_PAGESIZE);
+            for (size_t i = 0; i < file.mapped.length * sizeof(Element); i += page) {
+                bytes[i] = bytes[i];
+            }
+            return file;
+        }
+
+        /**!
+         * Write a sorted file out.
+         * @param path the file
+         * @param format its format
+         * @param file the elements
+         */
+        void store(const std::string &path, Format format, LoadedFile &file) {
+            if (format == Format::Binary) {
+                write_binary(path.c_str(), file.begin(), file.end());
+            } else {
+                write_text(path.c_str(), file.begin(), file.end());
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Information>> batch_sort(const Context &context, const std::vector<std::string> &inputs,
+                                                         const std::vector<std::string> &outputs,
+                                                         const BatchOptions &options) {
+        int rank;
+        MPI_Comm_rank(context.comm, &rank);
+
+        // The root tells the others whether its I/O failed, so that all processes throw together
+        std::exception_ptr failure;
+        auto agree = [&]() {
+            int failed = failure != nullptr;
+            MPI_Bcast(&failed, 1, MPI_INT, MASTER, context.comm);
+            if (failure != nullptr) {
+                std::rethrow_exception(failure);
+            }
+            if (failed) {
+                throw std::runtime_error("batch_sort: the root failed to read or write a file");
+            }
+        };
+        if (rank == MASTER && inputs.size() != outputs.size()) {
+            failure = std::make_exception_ptr(std::runtime_error("batch_sort: every input needs one output"));
+        }
+        agree();
+
+        uint64_t count = inputs.size();
+        MPI_Bcast(&count, 1, MPI_UINT64_T, MASTER, context.comm);
+
+        std::vector<std::unique_ptr<Information>> information;
+        std::future<LoadedFile> reading;
+        std::future<void> writing;
+        if (rank == MASTER && count > 0) {
+            reading = std::async(std::launch::async, load, inputs[0], options.input_format);
+        }
+        for (uint64_t k = 0; k < count; k++) {
+            // File k is read by now; file k + 1 is read, and file k - 1 written, while k is sorted
+            LoadedFile file;
+            if (rank == MASTER) {
+                try {
+                    file = reading.get();
+                    if (k + 1 < count) {
+                        reading = std::async(std::launch::async, load, inputs[k + 1], options.input_format);
+                    }
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+            }
+            agree();
+
+            auto info = context.mpi_sort(file.begin(), file.end());
+            if (rank != MASTER) {
+                continue;
+            }
+            information.push_back(std::move(info));
+            try {
+                if (writing.valid()) {
+                    writing.get();
+                }
+                writing = std::async(std::launch::async,
+                                     [file = std::move(file), path = outputs[k], format = options.output_format]()
+                                             mutable {
+                                         store(path, format, file);
+                                     });
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+        if (rank == MASTER && failure == nullptr && writing.valid()) {
+            try {
+                writing.get();
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+        agree();
+        return information;
+    }
+}
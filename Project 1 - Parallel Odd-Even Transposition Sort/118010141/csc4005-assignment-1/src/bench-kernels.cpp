@@ -0,0 +1,77 @@
+#include <sort-kernels.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    volatile sort::Element sink = 0;
+
+    // The compare-exchange loop as it was before the kernels: a branch per pair and a
+    // call through a function pointer for the swap
+    void (*swapPointer)(sort::Element *, sort::Element *) = [](sort::Element *first, sort::Element *second) {
+        sort::Element temp = *second;
+        *second = *first;
+        *first = temp;
+    };
+
+    bool legacyCompareExchange(sort::Element *array, int count) {
+        bool swapped = false;
+        for (int j = 0; j < count - 1; j += 2) {
+            if (*(array + j) > *(array + j + 1)) {
+                swapPointer(array + j, array + j + 1);
+                swapped = true;
+            }
+        }
+        return swapped;
+    }
+
+    /**!
+     * Time odd-even phases over a fresh copy of the input.
+     * @return nanoseconds per phase
+     */
+    template<typename Phase>
+    double timePhases(const std::vector<sort::Element> &input, int phases, Phase phase) {
+        std::vector<sort::Element> data = input;
+        bool swapped = false;
+        auto start = high_resolution_clock::now();
+        for (int i = 0; i < phases; i++) {
+            int offset = i % 2;
+            swapped |= phase(data.data() + offset, static_cast<int>(data.size()) - offset);
+        }
+        auto end = high_resolution_clock::now();
+        // keep the phases observable so they are not optimized away
+        sink = sink ^ swapped ^ data[data.size() / 2];
+        return static_cast<double>(duration_cast<nanoseconds>(end - start).count()) / phases;
+    }
+}
+
+int main(int argc, char **argv) {
+    int phases = argc > 1 ? std::atoi(argv[1]) : 64;
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<sort::Element>{};
+
+    std::cout << "size,kernel,ns_per_phase,speedup" << std::endl;
+    for (int size = 1 << 10; size <= 1 << 22; size <<= 2) {
+        std::vector<sort::Element> input(size);
+        for (auto &i : input) {
+            i = dist(gen);
+        }
+        double legacy = timePhases(input, phases, legacyCompareExchange);
+        std::cout << size << ",legacy," << legacy << ",1" << std::endl;
+        for (auto kernel : {sort::Kernel::Scalar, sort::Kernel::AVX2, sort::Kernel::AVX512}) {
+            if (!sort::kernel_supported(kernel)) {
+                continue;
+            }
+            double time = timePhases(input, phases, [kernel](sort::Element *array, int count) {
+                return sort::compare_exchange(kernel, array, count);
+            });
+            std::cout << size << "," << sort::kernel_name(kernel) << "," << time << "," << legacy / time << std::endl;
+        }
+    }
+    return 0;
+}
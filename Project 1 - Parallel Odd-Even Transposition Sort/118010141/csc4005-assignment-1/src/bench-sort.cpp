@@ -0,0 +1,261 @@
+#include <odd-even-sort.hpp>
+#include <workload.hpp>
+#include <mpi.h>
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std::chrono;
+
+namespace {
+    struct Options {
+        std::vector<size_t> sizes{10'000, 100'000, 1'000'000};
+        std::vector<sort::Distribution> distributions{
+                sort::Distribution::Uniform, sort::Distribution::Sorted, sort::Distribution::Reversed,
+                sort::Distribution::NearlySorted, sort::Distribution::FewUnique, sort::Distribution::Zipf,
+                sort::Distribution::Gaussian};
+        std::vector<sort::Engine> engines{sort::Engine::Block, sort::Engine::Bitonic, sort::Engine::Sample, sort::Engine::Radix};
+        std::vector<int> procs;  // empty for 1, 2, 4, ... and the world size
+        int repeats = 5;
+        int threads = 1;
+        uint64_t seed = 4005;
+        bool json = false;
+    };
+
+    /** Row
+     *  The result of one configuration
+     */
+    struct Row {
+        sort::Engine engine;
+        sort::Distribution distribution;
+        size_t size;
+        int procs;
+        int threads;
+        int64_t median_ns = 0;
+        int64_t min_ns = 0;
+        int64_t max_ns = 0;
+        double elements_per_s = 0;
+        double speedup = 0;  // median of the one-process run over this median
+        double efficiency = 0;  // speedup per process
+    };
+
+    /**!
+     * Parse a comma separated list.
+     * @param list the list
+     * @param parse parses one item into its output, returns whether it is valid
+     * @param output the items
+     * @return whether every item is valid
+     */
+    template<typename T, typename Parse>
+    bool parseList(const char *list, Parse parse, std::vector<T> &output) {
+        std::vector<T> items;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            T value;
+            if (!parse(item.c_str(), value)) {
+                return false;
+            }
+            items.push_back(value);
+        }
+        output = items;
+        return !output.empty();
+    }
+
+    bool parseNumber(const char *text, size_t &value) {
+        char *end;
+        value = std::strtoull(text, &end, 10);
+        return *text != '\0' && *end == '\0';
+    }
+
+    bool parseInt(const char *text, int &value) {
+        size_t number;
+        if (!parseNumber(text, number) || number == 0) {
+            return false;
+        }
+        value = static_cast<int>(number);
+        return true;
+    }
+
+    bool parseOptions(int argc, char **argv, Options &options) {
+        for (int i = 1; i < argc; i++) {
+            const char *arg = argv[i];
+            size_t number;
+            bool valid = false;
+            if (std::strncmp(arg, "--sizes=", 8) == 0) {
+                valid = parseList(arg + 8, parseNumber, options.sizes);
+            } else if (std::strncmp(arg, "--distributions=", 16) == 0) {
+                valid = parseList(arg + 16, sort::parse_distribution, options.distributions);
+            } else if (std::strncmp(arg, "--engines=", 10) == 0) {
+                valid = parseList(arg + 10, sort::parse_engine, options.engines);
+            } else if (std::strncmp(arg, "--procs=", 8) == 0) {
+                valid = parseList(arg + 8, parseInt, options.procs);
+            } else if (std::strncmp(arg, "--repeats=", 10) == 0) {
+                valid = parseInt(arg + 10, options.repeats);
+            } else if (std::strncmp(arg, "--threads=", 10) == 0) {
+                valid = parseInt(arg + 10, options.threads);
+            } else if (std::strncmp(arg, "--seed=", 7) == 0) {
+                valid = parseNumber(arg + 7, number);
+                options.seed = number;
+            } else if (std::strcmp(arg, "--format=csv") == 0) {
+                valid = true;
+                options.json = false;
+            } else if (std::strcmp(arg, "--format=json") == 0) {
+                valid = true;
+                options.json = true;
+            }
+            if (!valid) {
+                std::cerr << "invalid option: " << arg << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void printCsvHeader(std::ostream &output) {
+        output << "engine,distribution,size,procs,threads,median_ns,min_ns,max_ns,elements_per_s,speedup,efficiency"
+               << std::endl;
+    }
+
+    void printCsv(const Row &row, std::ostream &output) {
+        output << sort::engine_name(row.engine) << ',' << sort::distribution_name(row.distribution) << ','
+               << row.size << ',' << row.procs << ',' << row.threads << ',' << row.median_ns << ','
+               << row.min_ns << ',' << row.max_ns << ',' << row.elements_per_s << ',' << row.speedup << ','
+               << row.efficiency << std::endl;
+    }
+
+    void printJson(const std::vector<Row> &rows, std::ostream &output) {
+        output << "[" << std::endl;
+        for (size_t i = 0; i < rows.size(); i++) {
+            const Row &row = rows[i];
+            output << "  {\"engine\": \"" << sort::engine_name(row.engine) << "\", \"distribution\": \""
+                   << sort::distribution_name(row.distribution) << "\", \"size\": " << row.size
+                   << ", \"procs\": " << row.procs << ", \"threads\": " << row.threads
+                   << ", \"median_ns\": " << row.median_ns << ", \"min_ns\": " << row.min_ns
+                   << ", \"max_ns\": " << row.max_ns << ", \"elements_per_s\": " << row.elements_per_s
+                   << ", \"speedup\": " << row.speedup << ", \"efficiency\": " << row.efficiency << "}"
+                   << (i + 1 < rows.size() ? "," : "") << std::endl;
+        }
+        output << "]" << std::endl;
+    }
+
+    /**!
+     * Sort the input repeatedly on the processes of context.comm, after one warm-up run.
+     * @param context the context, with comm, engine and threads set
+     * @param input the input, significant at the root
+     * @param repeats number of timed runs
+     * @return the durations in ns at the root, sorted; empty elsewhere
+     */
+    std::vector<int64_t> timeRuns(const sort::Context &context, const std::vector<sort::Element> &input, int repeats) {
+        int rank;
+        MPI_Comm_rank(context.comm, &rank);
+        std::vector<sort::Element> data;
+        std::vector<int64_t> durations;
+        for (int r = 0; r <= repeats; r++) {
+            if (rank == 0) {
+                data = input;
+            }
+            MPI_Barrier(context.comm);
+            auto info = context.mpi_sort(data.data(), data.data() + data.size());
+            if (rank == 0) {
+                if (!std::is_sorted(data.begin(), data.end())) {
+                    std::cerr << "unsorted output from " << sort::engine_name(context.engine) << std::endl;
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                if (r > 0) {  // run 0 warms up allocations and threads
+                    durations.push_back(duration_cast<nanoseconds>(info->end - info->start).count());
+                }
+            }
+        }
+        std::sort(durations.begin(), durations.end());
+        return durations;
+    }
+}
+
+int main(int argc, char **argv) {
+    sort::Context context(argc, argv);
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        if (rank == 0) {
+            std::cerr << "usage: " << argv[0] << " [--sizes=<n>,...] [--distributions=<name>,...]"
+                      << " [--engines=<name>,...] [--procs=<p>,...] [--repeats=<r>] [--threads=<t>]"
+                      << " [--seed=<s>] [--format=csv|json]" << std::endl;
+        }
+        return 1;
+    }
+    if (options.procs.empty()) {
+        for (int p = 1; p < size; p *= 2) {
+            options.procs.push_back(p);
+        }
+        options.procs.push_back(size);
+    }
+    // The one-process run is the baseline of the speedups, so it runs first and the others ascend
+    options.procs.erase(std::remove_if(options.procs.begin(), options.procs.end(),
+                                       [&](int p) { return p < 1 || p > size; }), options.procs.end());
+    std::sort(options.procs.begin(), options.procs.end());
+    options.procs.erase(std::unique(options.procs.begin(), options.procs.end()), options.procs.end());
+    if (options.procs.empty() || options.procs.front() != 1) {
+        options.procs.insert(options.procs.begin(), 1);
+    }
+    context.threads = options.threads;
+
+    std::vector<Row> rows;
+    if (rank == 0 && !options.json) {
+        printCsvHeader(std::cout);
+    }
+    for (auto engine : options.engines) {
+        for (auto distribution : options.distributions) {
+            for (auto count : options.sizes) {
+                std::vector<sort::Element> input;
+                if (rank == 0) {
+                    input.resize(count);
+                    sort::generate(distribution, options.seed, count, 0, input.data(), input.data() + count);
+                }
+                double baseline = 0;
+                for (int procs : options.procs) {
+                    // The first procs processes sort, the others wait at the barrier below
+                    MPI_Comm comm;
+                    MPI_Comm_split(MPI_COMM_WORLD, rank < procs ? 0 : MPI_UNDEFINED, rank, &comm);
+                    if (comm != MPI_COMM_NULL) {
+                        context.comm = comm;
+                        context.engine = engine;
+                        auto durations = timeRuns(context, input, options.repeats);
+                        context.comm = MPI_COMM_WORLD;
+                        MPI_Comm_free(&comm);
+                        if (rank == 0) {
+                            Row row{engine, distribution, count, procs, options.threads};
+                            row.median_ns = durations[durations.size() / 2];
+                            row.min_ns = durations.front();
+                            row.max_ns = durations.back();
+                            double seconds = std::max<double>(row.median_ns, 1) / 1e9;
+                            row.elements_per_s = count / seconds;
+                            if (procs == 1) {
+                                baseline = seconds;
+                            }
+                            row.speedup = baseline / seconds;
+                            row.efficiency = row.speedup / procs;
+                            if (options.json) {
+                                rows.push_back(row);
+                            } else {
+                                printCsv(row, std::cout);
+                            }
+                        }
+                    }
+                    MPI_Barrier(MPI_COMM_WORLD);
+                }
+            }
+        }
+    }
+    if (rank == 0 && options.json) {
+        printJson(rows, std::cout);
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <mpi.h>
+#include <vector>
+#include <bit>
+
+#define MASTER 0
+
+namespace sort {
+    namespace {
+        /**!
+         * Free the hypercube kept as an attribute, when its communicator is freed.
+         */
+        int freeCube(MPI_Comm, int, void *attribute, void *) {
+            auto *cube = static_cast<MPI_Comm *>(attribute);
+            MPI_Comm_free(cube);
+            delete cube;
+            return MPI_SUCCESS;
+        }
+    }
+
+    MPI_Comm Context::hypercube() const {
+        if (cube_key == MPI_KEYVAL_INVALID) {
+            MPI_Comm_create_keyval(MPI_COMM_NULL_COPY_FN, freeCube, &cube_key, nullptr);
+        }
+        void *attribute;
+        int found;
+        MPI_Comm_get_attr(comm, cube_key, &attribute, &found);
+        if (found) {
+            return *static_cast<MPI_Comm *>(attribute);
+        }
+
+        int size;
+        MPI_Comm_size(comm, &size);
+        int dimensions = std::countr_zero(static_cast<unsigned>(size));
+        std::vector<int> dims(dimensions, 2);
+        std::vector<int> periods(dimensions, 0);
+        // No reordering: the blocks end up in rank order of comm, which is where they are gathered
+        auto *cube = new MPI_Comm;
+        MPI_Cart_create(comm, dimensions, dims.data(), periods.data(), 0, cube);
+        MPI_Comm_set_attr(comm, cube_key, cube);
+        return *cube;
+    }
+
+    template<typename T, typename Compare>
+    size_t Context::bitonicSort(T* localArray, size_t &localCount, size_t blockCount, Compare compare) const {
+        int rank;
+        int size;
+        size_t remoteCount;
+        size_t stages = 0;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        localSort(localArray, localCount, compare);
+        if (size == 1) {
+            return 0;
+        }
+
+        MPI_Comm cube = hypercube();
+        int dimensions = std::countr_zero(static_cast<unsigned>(size));
+        std::vector<T> &remote = buffers.get<T>(BufferPool::Remote);
+        std::vector<T> &merged = buffers.get<T>(BufferPool::Merged);
+        remote.resize(blockCount);
+        merged.resize(blockCount);
+
+        // Blocks are logically padded to blockCount with +inf, as in blockSort. Merging the
+        // sequences of 2^d blocks, every group of 2^(d+1) ranks ascends where bit d + 1 of the
+        // rank is 0 and descends where it is 1, so that pairs of groups form bitonic sequences.
+        for (int d = 0; d < dimensions; d++) {
+            bool ascending = ((rank >> (d + 1)) & 1) == 0;
+            for (int bit = d; bit >= 0; bit--) {
+                // Bit b of the rank is the coordinate of dimension dimensions - 1 - b, the partner is across it
+                int source;
+                int destination;
+                MPI_Cart_shift(cube, dimensions - 1 - bit, 1, &source, &destination);
+                int partner = destination != MPI_PROC_NULL ? destination : source;
+                {
+                    PhaseScope scope(clock, Phase::Exchange);
+                    remoteCount = sendrecv(localArray, localCount, remote.data(), blockCount, type, partner, MASTER,
+                                           cube, chunk_limit, &persistentRequests());
+                }
+                localCount = mergeSplit(localArray, localCount, remote.data(), remoteCount, blockCount,
+                                        rank < partner, (rank < partner) == ascending, merged.data(), compare);
+                stages++;
+            }
+        }
+        return stages;
+    }
+
+#define SORT_INSTANTIATE(T) \
+    template size_t Context::bitonicSort(T *, size_t &, size_t, std::less<T>) const; \
+    template size_t Context::bitonicSort(T *, size_t &, size_t, std::greater<T>) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
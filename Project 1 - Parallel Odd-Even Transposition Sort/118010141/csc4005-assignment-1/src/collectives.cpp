@@ -0,0 +1,265 @@
+#include <collectives.hpp>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+namespace sort {
+    namespace {
+        constexpr int chunkTag = 4005;
+        constexpr size_t maxRequests = 64;  // persistent requests kept, the older half goes when full
+
+        /**!
+         * Whether counts and displacements can go to a native collective as ints.
+         */
+        bool fits(const std::vector<size_t> &counts, const std::vector<size_t> &displs, size_t chunk) {
+            for (size_t i = 0; i < counts.size(); i++) {
+                if (counts[i] > chunk || displs[i] > INT_MAX) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**!
+         * Agree on the path: native only if it fits everywhere.
+         */
+        bool fitsEverywhere(bool local, MPI_Comm comm) {
+            int flag = local;
+            int global;
+            MPI_Allreduce(&flag, &global, 1, MPI_INT, MPI_LAND, comm);
+            return global;
+        }
+
+        /**!
+         * Convert counts or displacements to int, into a slot kept between calls.
+         * @param values the values, each fits in an int
+         * @param buffers the caller's scratch space
+         * @param slot the slot for the converted values
+         * @return the converted values
+         */
+        const int *toInt(const std::vector<size_t> &values, BufferPool &buffers, BufferPool::Slot slot) {
+            std::vector<int> &converted = buffers.get<int>(slot);
+            converted.assign(values.begin(), values.end());
+            return converted.data();
+        }
+
+        MPI_Aint extentOf(MPI_Datatype type) {
+            MPI_Aint lowerBound;
+            MPI_Aint extent;
+            MPI_Type_get_extent(type, &lowerBound, &extent);
+            return extent;
+        }
+
+        /**!
+         * Post the receives or the sends of one transfer, one request per chunk.
+         */
+        void postRecvs(std::vector<MPI_Request> &requests, void *buffer, size_t count, MPI_Datatype type,
+                       int peer, MPI_Comm comm, size_t chunk) {
+            auto *bytes = static_cast<char *>(buffer);
+            MPI_Aint extent = extentOf(type);
+            for (size_t offset = 0; offset < count; offset += chunk) {
+                int piece = static_cast<int>(std::min(chunk, count - offset));
+                requests.emplace_back();
+                MPI_Irecv(bytes + offset * extent, piece, type, peer, chunkTag, comm, &requests.back());
+            }
+        }
+
+        void postSends(std::vector<MPI_Request> &requests, const void *buffer, size_t count, MPI_Datatype type,
+                       int peer, MPI_Comm comm, size_t chunk) {
+            const auto *bytes = static_cast<const char *>(buffer);
+            MPI_Aint extent = extentOf(type);
+            for (size_t offset = 0; offset < count; offset += chunk) {
+                int piece = static_cast<int>(std::min(chunk, count - offset));
+                requests.emplace_back();
+                MPI_Isend(bytes + offset * extent, piece, type, peer, chunkTag, comm, &requests.back());
+            }
+        }
+
+        void waitAll(std::vector<MPI_Request> &requests) {
+            MPI_Waitall(static_cast<int>(requests.size()), requests.data(), MPI_STATUSES_IGNORE);
+        }
+    }
+
+    void scatterv(const void *send, const std::vector<size_t> &counts, const std::vector<size_t> &displs,
+                  void *recv, size_t recvCount, MPI_Datatype type, int root, MPI_Comm comm, size_t chunk,
+                  BufferPool &buffers) {
+        int rank;
+        int size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        if (fitsEverywhere(rank != root || fits(counts, displs, chunk), comm)) {
+            const int *intCounts = nullptr;
+            const int *intDispls = nullptr;
+            if (rank == root) {
+                intCounts = toInt(counts, buffers, BufferPool::IntSendCounts);
+                intDispls = toInt(displs, buffers, BufferPool::IntSendDispls);
+            }
+            MPI_Scatterv(send, intCounts, intDispls, type,
+                         recv, static_cast<int>(recvCount), type, root, comm);
+            return;
+        }
+
+        std::vector<MPI_Request> requests;
+        postRecvs(requests, recv, recvCount, type, root, comm, chunk);
+        if (rank == root) {
+            MPI_Aint extent = extentOf(type);
+            for (int r = 0; r < size; r++) {
+                postSends(requests, static_cast<const char *>(send) + displs[r] * extent, counts[r], type, r,
+                          comm, chunk);
+            }
+        }
+        waitAll(requests);
+    }
+
+    void gatherv(const void *send, size_t sendCount, void *recv, const std::vector<size_t> &counts,
+                 const std::vector<size_t> &displs, MPI_Datatype type, int root, MPI_Comm comm, size_t chunk,
+                 BufferPool &buffers) {
+        int rank;
+        int size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        if (fitsEverywhere(rank != root || fits(counts, displs, chunk), comm)) {
+            const int *intCounts = nullptr;
+            const int *intDispls = nullptr;
+            if (rank == root) {
+                intCounts = toInt(counts, buffers, BufferPool::IntSendCounts);
+                intDispls = toInt(displs, buffers, BufferPool::IntSendDispls);
+            }
+            MPI_Gatherv(send, static_cast<int>(sendCount), type,
+                        recv, intCounts, intDispls, type, root, comm);
+            return;
+        }
+
+        std::vector<MPI_Request> requests;
+        if (rank == root) {
+            MPI_Aint extent = extentOf(type);
+            for (int r = 0; r < size; r++) {
+                postRecvs(requests, static_cast<char *>(recv) + displs[r] * extent, counts[r], type, r,
+                          comm, chunk);
+            }
+        }
+        postSends(requests, send, sendCount, type, root, comm, chunk);
+        waitAll(requests);
+    }
+
+    void alltoallv(const void *send, const std::vector<size_t> &sendCounts, const std::vector<size_t> &sendDispls,
+                   void *recv, const std::vector<size_t> &recvCounts, const std::vector<size_t> &recvDispls,
+                   MPI_Datatype type, MPI_Comm comm, size_t chunk, BufferPool &buffers) {
+        int size;
+        MPI_Comm_size(comm, &size);
+
+        if (fitsEverywhere(fits(sendCounts, sendDispls, chunk) && fits(recvCounts, recvDispls, chunk), comm)) {
+            MPI_Alltoallv(send, toInt(sendCounts, buffers, BufferPool::IntSendCounts),
+                          toInt(sendDispls, buffers, BufferPool::IntSendDispls), type,
+                          recv, toInt(recvCounts, buffers, BufferPool::IntRecvCounts),
+                          toInt(recvDispls, buffers, BufferPool::IntRecvDispls), type, comm);
+            return;
+        }
+
+        // Messages between a pair with the same tag arrive in order, so the chunks line up
+        MPI_Aint extent = extentOf(type);
+        std::vector<MPI_Request> requests;
+        for (int r = 0; r < size; r++) {
+            postRecvs(requests, static_cast<char *>(recv) + recvDispls[r] * extent, recvCounts[r], type, r,
+                      comm, chunk);
+        }
+        for (int r = 0; r < size; r++) {
+            postSends(requests, static_cast<const char *>(send) + sendDispls[r] * extent, sendCounts[r], type, r,
+                      comm, chunk);
+        }
+        waitAll(requests);
+    }
+
+    size_t sendrecv(const void *send, size_t sendCount, void *recv, size_t recvCapacity, MPI_Datatype type,
+                    int partner, int tag, MPI_Comm comm, size_t chunk, RequestCache *persistent) {
+        if (recvCapacity <= chunk && persistent != nullptr) {
+            // The receive is keyed on the capacity and always repeats. A send shorter than the
+            // capacity changes length from phase to phase, a persistent request for it would be
+            // used once and crowd the others out, so only full blocks get one.
+            MPI_Request both[2] = {persistent->recv(recv, recvCapacity, type, partner, tag, comm), MPI_REQUEST_NULL};
+            MPI_Status statuses[2];
+            int received;
+            if (sendCount == recvCapacity) {
+                both[1] = persistent->send(send, sendCount, type, partner, tag, comm);
+                MPI_Startall(2, both);
+            } else {
+                MPI_Start(&both[0]);
+                MPI_Isend(send, static_cast<int>(sendCount), type, partner, tag, comm, &both[1]);
+            }
+            MPI_Waitall(2, both, statuses);
+            MPI_Get_count(&statuses[0], type, &received);
+            return received;
+        }
+        if (recvCapacity <= chunk) {  // both sides share the bound, so they agree on the path
+            MPI_Status status;
+            int received;
+            MPI_Sendrecv(send, static_cast<int>(sendCount), type, partner, tag,
+                         recv, static_cast<int>(recvCapacity), type, partner, tag, comm, &status);
+            MPI_Get_count(&status, type, &received);
+            return received;
+        }
+
+        uint64_t localCount = sendCount;
+        uint64_t remoteCount;
+        MPI_Sendrecv(&localCount, 1, MPI_UINT64_T, partner, tag, &remoteCount, 1, MPI_UINT64_T, partner, tag,
+                     comm, MPI_STATUS_IGNORE);
+        std::vector<MPI_Request> requests;
+        postRecvs(requests, recv, remoteCount, type, partner, comm, chunk);
+        postSends(requests, send, sendCount, type, partner, comm, chunk);
+        waitAll(requests);
+        return remoteCount;
+    }
+
+    RequestCache::~RequestCache() {
+        clear();
+    }
+
+    MPI_Request RequestCache::send(const void *buffer, size_t count, MPI_Datatype type, int peer, int tag,
+                                   MPI_Comm comm) {
+        return find({true, buffer, count, type, peer, tag, comm, MPI_REQUEST_NULL});
+    }
+
+    MPI_Request RequestCache::recv(void *buffer, size_t count, MPI_Datatype type, int peer, int tag, MPI_Comm comm) {
+        return find({false, buffer, count, type, peer, tag, comm, MPI_REQUEST_NULL});
+    }
+
+    size_t RequestCache::size() const {
+        return entries.size();
+    }
+
+    void RequestCache::clear() {
+        for (Entry &entry : entries) {
+            MPI_Request_free(&entry.request);
+        }
+        entries.clear();
+    }
+
+    MPI_Request RequestCache::find(const Entry &key) {
+        for (const Entry &entry : entries) {
+            if (entry.send == key.send && entry.buffer == key.buffer && entry.count == key.count &&
+                entry.type == key.type && entry.peer == key.peer && entry.tag == key.tag && entry.comm == key.comm) {
+                return entry.request;
+            }
+        }
+        if (entries.size() == maxRequests) {
+            // The oldest ones go; the newest, e.g. the other half of a pair being set up, stay
+            auto older = entries.begin() + maxRequests / 2;
+            for (auto entry = entries.begin(); entry != older; ++entry) {
+                MPI_Request_free(&entry->request);
+            }
+            entries.erase(entries.begin(), older);
+        }
+        Entry entry = key;
+        auto buffer = const_cast<void *>(key.buffer);
+        int count = static_cast<int>(key.count);
+        if (key.send) {
+            MPI_Send_init(buffer, count, key.type, key.peer, key.tag, key.comm, &entry.request);
+        } else {
+            MPI_Recv_init(buffer, count, key.type, key.peer, key.tag, key.comm, &entry.request);
+        }
+        entries.push_back(entry);
+        return entry.request;
+    }
+}
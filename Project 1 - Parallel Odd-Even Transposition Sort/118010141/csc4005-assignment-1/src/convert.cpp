@@ -0,0 +1,22 @@
+#include <sort-io.hpp>
+#include <iostream>
+#include <cstring>
+#include <vector>
+
+int main(int argc, char **argv) {
+    sort::Format to;
+    if (argc < 4 || std::strncmp(argv[3], "--to=", 5) != 0 || !sort::parse_format(argv[3] + 5, to)) {
+        std::cerr << "wrong arguments" << std::endl;
+        std::cerr << "usage: " << argv[0] << " <input-file> <output-file> --to=text|binary" << std::endl;
+        return 1;
+    }
+
+    if (to == sort::Format::Binary) {
+        auto data = sort::read_text(argv[1]);
+        sort::write_binary(argv[2], data.data(), data.data() + data.size());
+    } else {
+        auto data = sort::MappedArray::open(argv[1]);
+        sort::write_text(argv[2], data.begin(), data.end());
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <type_traits>
+
+namespace sort {
+    namespace {
+        constexpr size_t distinctSamples = 1024;  // keys every process samples for the estimate
+        constexpr uint64_t maxDistinct = 1 << 12;  // different keys up to which counting beats sorting
+        constexpr uint64_t minCountingSort = 1 << 16;  // elements below which the engines are as fast
+
+        /**!
+         * std::lower_bound without branches on the comparisons, which random keys mispredict half
+         * of the time. The step is a product rather than a choice: compilers turn the choice into
+         * a branch, and counting then ran 5 times slower.
+         * @param keys the keys, in order
+         * @param count number of keys
+         * @param x the key to look for
+         * @param compare the order
+         * @return the index of the first key not before x
+         */
+        template<typename T, typename Compare>
+        size_t lowerBound(const T *keys, size_t count, const T &x, Compare compare) {
+            if (count == 0) {
+                return 0;
+            }
+            const T *base = keys;
+            while (count > 1) {
+                size_t half = count / 2;
+                base += compare(base[half - 1], x) * half;
+                count -= half;
+            }
+            return base - keys + compare(*base, x);
+        }
+    }
+
+    template<typename T, typename Compare>
+    uint64_t Context::estimateDistinct(const T *localArray, size_t localCount, Compare compare) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::vector<T> &samples = buffers.get<T>(BufferPool::Samples);
+        std::vector<T> &allSamples = buffers.get<T>(BufferPool::Bucket);
+        std::vector<uint64_t> &sizes = buffers.get<uint64_t>(BufferPool::Sizes);
+        samples.resize(distinctSamples);
+        allSamples.resize(distinctSamples * size);
+        sizes.resize(size);
+
+        // A slice no larger than the sample is taken whole, repeats then are real ones
+        uint64_t taken = std::min<uint64_t>(localCount, distinctSamples);
+        if (taken == localCount) {
+            std::copy(localArray, localArray + localCount, samples.begin());
+        } else {
+            std::mt19937_64 random(rank + 1);
+            for (uint64_t i = 0; i < taken; i++) {
+                samples[i] = localArray[random() % localCount];
+            }
+        }
+        {
+            PhaseScope scope(clock, Phase::Exchange);
+            MPI_Allgather(&taken, 1, MPI_UINT64_T, sizes.data(), 1, MPI_UINT64_T, comm);
+            MPI_Allgather(samples.data(), distinctSamples, type, allSamples.data(), distinctSamples, type, comm);
+        }
+        size_t count = 0;
+        for (int r = 0; r < size; r++) {
+            auto first = allSamples.begin() + r * distinctSamples;
+            count = std::copy(first, first + sizes[r], allSamples.begin() + count) - allSamples.begin();
+        }
+        std::sort(allSamples.begin(), allSamples.begin() + count, compare);
+
+        // Keys seen, seen once and seen twice
+        uint64_t seen = 0;
+        uint64_t once = 0;
+        uint64_t twice = 0;
+        for (size_t i = 0; i < count;) {
+            size_t j = i + 1;
+            while (j < count && !compare(allSamples[i], allSamples[j])) {
+                j++;
+            }
+            seen++;
+            once += j - i == 1;
+            twice += j - i == 2;
+            i = j;
+        }
+        return seen + (once > 0 ? once * (once - 1) / (2 * (twice + 1)) : 0);
+    }
+
+    template<typename T, typename Compare>
+    bool Context::distinctKeySort(std::vector<T> &local, size_t totalCount, Compare compare) const {
+        if constexpr (!std::is_integral_v<T>) {
+            return false;
+        } else {
+            if (totalCount < minCountingSort || estimateDistinct(local.data(), local.size(), compare) > maxDistinct) {
+                return false;
+            }
+            int rank;
+            int size;
+            MPI_Datatype type = mpi_type<T>();
+
+            MPI_Comm_rank(comm, &rank);
+            MPI_Comm_size(comm, &size);
+
+            // The keys of the slice in order with their counts, until there are too many
+            std::vector<T> &localKeys = buffers.get<T>(BufferPool::LocalKeys);
+            std::vector<uint64_t> &localCounts = buffers.get<uint64_t>(BufferPool::LocalKeyCounts);
+            localKeys.clear();
+            localCounts.clear();
+            bool overflow = false;
+            size_t last = 0;  // index of the last key met, a run of equal keys skips the search
+            for (const T &x : local) {
+                if (last < localKeys.size() && localKeys[last] == x) {
+                    localCounts[last]++;
+                    continue;
+                }
+                last = lowerBound(localKeys.data(), localKeys.size(), x, compare);
+                if (last < localKeys.size() && localKeys[last] == x) {
+                    localCounts[last]++;
+                    continue;
+                }
+                if (localKeys.size() == maxDistinct) {
+                    overflow = true;
+                    break;
+                }
+                localKeys.insert(localKeys.begin() + static_cast<std::ptrdiff_t>(last), x);
+                localCounts.insert(localCounts.begin() + static_cast<std::ptrdiff_t>(last), 1);
+            }
+
+            // All processes get all keys; the estimate was wrong if any slice or their union has too many
+            std::vector<uint64_t> &sizes = buffers.get<uint64_t>(BufferPool::Sizes);
+            std::vector<T> &keys = buffers.get<T>(BufferPool::Keys);
+            std::vector<uint64_t> &counts = buffers.get<uint64_t>(BufferPool::KeyCounts);
+            uint64_t mine[2] = {localKeys.size(), overflow};
+            sizes.resize(2 * size);
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Allgather(mine, 2, MPI_UINT64_T, sizes.data(), 2, MPI_UINT64_T, comm);
+            }
+            std::vector<int> &keyCounts = buffers.get<int>(BufferPool::NativeCounts);
+            std::vector<int> &keyDispls = buffers.get<int>(BufferPool::NativeDispls);
+            keyCounts.resize(size);
+            keyDispls.resize(size);
+            for (int r = 0; r < size; r++) {
+                if (sizes[2 * r + 1] != 0) {
+                    return false;
+                }
+                keyCounts[r] = static_cast<int>(sizes[2 * r]);
+                keyDispls[r] = r == 0 ? 0 : keyDispls[r - 1] + keyCounts[r - 1];
+            }
+            keys.resize(keyDispls[size - 1] + keyCounts[size - 1]);
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Allgatherv(localKeys.data(), static_cast<int>(localKeys.size()), type, keys.data(),
+                               keyCounts.data(), keyDispls.data(), type, comm);
+            }
+            std::sort(keys.begin(), keys.end(), compare);
+            keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+            if (keys.size() > maxDistinct) {
+                return false;
+            }
+
+            // Both key lists are in order, the local counts add up in one walk
+            counts.assign(keys.size(), 0);
+            size_t k = 0;
+            for (size_t i = 0; i < localKeys.size(); i++) {
+                while (keys[k] != localKeys[i]) {
+                    k++;
+                }
+                counts[k] = localCounts[i];
+            }
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Allreduce(MPI_IN_PLACE, counts.data(), static_cast<int>(counts.size()), MPI_UINT64_T, MPI_SUM,
+                              comm);
+            }
+
+            uint64_t first = rank * totalCount / size;
+            uint64_t end = (rank + 1) * totalCount / size;
+            local.resize(end - first);
+            writeCounted(local.data(), first, end);
+            return true;
+        }
+    }
+
+    template<typename T>
+    void Context::writeCounted(T *output, uint64_t from, uint64_t to) const {
+        std::vector<T> &keys = buffers.get<T>(BufferPool::Keys);
+        std::vector<uint64_t> &counts = buffers.get<uint64_t>(BufferPool::KeyCounts);
+        uint64_t position = 0;  // where the run of key k starts
+        for (size_t k = 0; k < keys.size() && position < to; k++) {
+            uint64_t first = std::max(position, from);
+            uint64_t last = std::min(position + counts[k], to);
+            if (first < last) {
+                std::fill(output + (first - from), output + (last - from), keys[k]);
+            }
+            position += counts[k];
+        }
+    }
+
+#define SORT_INSTANTIATE_ORDER(T, Compare) \
+    template uint64_t Context::estimateDistinct(const T *, size_t, Compare) const; \
+    template bool Context::distinctKeySort(std::vector<T> &, size_t, Compare) const;
+#define SORT_INSTANTIATE(T) SORT_INSTANTIATE_ORDER(T, std::less<T>) SORT_INSTANTIATE_ORDER(T, std::greater<T>) \
+    template void Context::writeCounted(T *, uint64_t, uint64_t) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
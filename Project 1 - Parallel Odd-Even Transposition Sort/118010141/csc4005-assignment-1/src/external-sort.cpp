@@ -0,0 +1,414 @@
+#include <external-sort.hpp>
+#include <text-io.hpp>
+#include <collectives.hpp>
+#include <mpi.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+
+#define MASTER 0
+
+namespace sort {
+    using namespace std::chrono;
+
+    namespace {
+        constexpr size_t minBuffer = size_t{1} << 12;  // elements of the smallest merge buffer, 32 KiB
+        constexpr size_t maxTextChunk = size_t{1} << 22;  // bytes per read or write of a text file
+        constexpr size_t textShare = 16;  // a text file takes at most this fraction of the limit for its chunks
+
+        std::runtime_error ioError(const std::string &what, const std::string &path) {
+            return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+        }
+
+        /**!
+         * Read until the buffer is full or the file ends.
+         * @return the number of bytes read
+         */
+        size_t readAll(int fd, void *data, size_t bytes, const std::string &path) {
+            auto position = static_cast<char *>(data);
+            size_t total = 0;
+            while (total < bytes) {
+                ssize_t got = ::read(fd, position + total, bytes - total);
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (got < 0) {
+                    throw ioError("failed to read", path);
+                }
+                if (got == 0) {
+                    break;
+                }
+                total += got;
+            }
+            return total;
+        }
+
+        /** Descriptor
+         *  An open file, closed when destroyed
+         */
+        struct Descriptor {
+            std::string path;
+            int fd;
+
+            Descriptor(std::string path, int flags) : path(std::move(path)), fd(::open(this->path.c_str(), flags, 0644)) {
+                if (fd < 0) {
+                    throw ioError("failed to open", this->path);
+                }
+                posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+
+            ~Descriptor() {
+                ::close(fd);
+            }
+
+            Descriptor(const Descriptor &) = delete;
+
+            Descriptor &operator=(const Descriptor &) = delete;
+        };
+
+        /** RunFile
+         *  A sorted run of raw elements in host byte order, removed when destroyed
+         */
+        struct RunFile {
+            std::string path;
+
+            explicit RunFile(const std::string &directory) {
+                path = directory + "/sort-run-XXXXXX";
+                int fd = mkstemp(path.data());
+                if (fd < 0) {
+                    throw ioError("failed to create a run in", directory);
+                }
+                ::close(fd);
+            }
+
+            ~RunFile() {
+                ::unlink(path.c_str());
+            }
+
+            RunFile(const RunFile &) = delete;
+
+            RunFile &operator=(const RunFile &) = delete;
+        };
+
+        /** ChunkReader
+         *  Reads the input in either format, a bounded number of elements at a time
+         */
+        class ChunkReader {
+        public:
+            ChunkReader(const char *path, Format format, size_t textChunk) {
+                if (format == Format::Text) {
+                    text = std::make_unique<TextReader>(path, textChunk);
+                } else {
+                    binary = std::make_unique<Descriptor>(path, O_RDONLY);
+                }
+            }
+
+            /**!
+             * Read the next elements.
+             * @param output destination for at most count elements
+             * @param count capacity of output
+             * @return the number of elements read, less than count only at the end of the file
+             */
+            size_t read(Element *output, size_t count) {
+                if (text) {
+                    return text->read(output, count);
+                }
+                size_t bytes = readAll(binary->fd, output, count * sizeof(Element), binary->path);
+                if (bytes % sizeof(Element) != 0) {
+                    throw std::runtime_error("binary input is not a whole number of elements: " + binary->path);
+                }
+                to_little_endian(output, output + bytes / sizeof(Element));  // the same swap back to host order
+                return bytes / sizeof(Element);
+            }
+
+        private:
+            std::unique_ptr<TextReader> text;
+            std::unique_ptr<Descriptor> binary;
+        };
+
+        /** RunReader
+         *  Streams a run through a fixed buffer
+         */
+        class RunReader {
+        public:
+            RunReader(const RunFile &run, size_t bufferSize) : file(run.path, O_RDONLY), buffer(bufferSize) {
+                fill();
+            }
+
+            bool exhausted() const {
+                return position == size;
+            }
+
+            Element head() const {
+                return buffer[position];
+            }
+
+            void advance() {
+                if (++position == size) {
+                    fill();
+                }
+            }
+
+        private:
+            void fill() {
+                size = readAll(file.fd, buffer.data(), buffer.size() * sizeof(Element), file.path) / sizeof(Element);
+                position = 0;
+            }
+
+            Descriptor file;
+            std::vector<Element> buffer;
+            size_t position = 0;
+            size_t size = 0;
+        };
+
+        /** LoserTree
+         *  Tournament tree over the heads of k runs: every inner node keeps the loser of the
+         *  match below it and node 0 the overall winner, so replacing the winner replays only
+         *  the log2(k) matches on its path. Leaves are padded to a power of two with runs
+         *  that are always exhausted.
+         */
+        class LoserTree {
+        public:
+            explicit LoserTree(std::vector<std::unique_ptr<RunReader>> &runs)
+                    : runs(runs), leaves(std::bit_ceil(std::max<size_t>(runs.size(), 1))), nodes(leaves) {
+                std::vector<size_t> winners(2 * leaves);
+                for (size_t i = 0; i < leaves; i++) {
+                    winners[leaves + i] = i;
+                }
+                for (size_t n = leaves - 1; n >= 1; n--) {
+                    size_t first = winners[2 * n];
+                    size_t second = winners[2 * n + 1];
+                    bool firstWins = before(first, second);
+                    winners[n] = firstWins ? first : second;
+                    nodes[n] = firstWins ? second : first;
+                }
+                nodes[0] = winners[1];
+            }
+
+            bool empty() const {
+                return !live(nodes[0]);
+            }
+
+            Element top() const {
+                return runs[nodes[0]]->head();
+            }
+
+            void pop() {
+                size_t winner = nodes[0];
+                runs[winner]->advance();
+                for (size_t n = (leaves + winner) / 2; n >= 1; n /= 2) {
+                    if (before(nodes[n], winner)) {
+                        std::swap(nodes[n], winner);
+                    }
+                }
+                nodes[0] = winner;
+            }
+
+        private:
+            bool live(size_t leaf) const {
+                return leaf < runs.size() && !runs[leaf]->exhausted();
+            }
+
+            bool before(size_t first, size_t second) const {
+                if (!live(first)) {
+                    return false;
+                }
+                return !live(second) || runs[first]->head() < runs[second]->head();
+            }
+
+            std::vector<std::unique_ptr<RunReader>> &runs;
+            size_t leaves;
+            std::vector<size_t> nodes;
+        };
+
+        /**!
+         * Merge sorted runs and hand the result out in batches.
+         * Holds count + 1 buffers of bufferSize elements.
+         * @param first first run
+         * @param count number of runs
+         * @param bufferSize elements per read buffer and per output batch
+         * @param flush takes every batch as (begin, end), may modify it
+         */
+        template<typename Flush>
+        void mergeRuns(const std::unique_ptr<RunFile> *first, size_t count, size_t bufferSize, Flush flush) {
+            std::vector<std::unique_ptr<RunReader>> readers;
+            for (size_t i = 0; i < count; i++) {
+                readers.push_back(std::make_unique<RunReader>(*first[i], bufferSize));
+            }
+            LoserTree tree(readers);
+            std::vector<Element> batch(bufferSize);
+            size_t used = 0;
+            while (!tree.empty()) {
+                batch[used++] = tree.top();
+                tree.pop();
+                if (used == batch.size()) {
+                    flush(batch.data(), batch.data() + used);
+                    used = 0;
+                }
+            }
+            flush(batch.data(), batch.data() + used);
+        }
+
+        /**!
+         * Add the phase counts and phase times of one chunk to the information of the whole sort.
+         */
+        void accumulate(Information &total, const Information &chunk) {
+            total.phases += chunk.phases;
+            total.ranks.resize(chunk.ranks.size());
+            for (size_t r = 0; r < chunk.ranks.size(); r++) {
+                for (size_t p = 0; p < phase_count; p++) {
+                    total.ranks[r][p] += chunk.ranks[r][p];
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<Information> external_sort(const Context &context, const char *input, const char *output,
+                                               const ExternalOptions &options) {
+        int rank;
+        int size;
+        MPI_Comm_rank(context.comm, &rank);
+        MPI_Comm_size(context.comm, &size);
+
+        // The text reader and writer may be open together; their chunks come off the limit first
+        size_t textChunk = std::min(options.memory_limit / (textShare * text_chunks_in_flight), maxTextChunk);
+        size_t textSides = (options.input_format == Format::Text) + (options.output_format == Format::Text);
+        size_t textBytes = textSides * text_chunks_in_flight * textChunk;
+        size_t limit = (options.memory_limit - textBytes) / sizeof(Element);
+        if (limit < 3 * minBuffer) {
+            throw std::runtime_error("the memory limit of an external sort leaves less than 96 KiB next to its text "
+                                     "buffers");
+        }
+        // Next to a chunk of n elements, mpi_sort keeps up to three slices of n / size on the root
+        size_t capacity = limit * size / (size + 3);
+        std::string directory = options.temp_dir.empty() ? std::filesystem::temp_directory_path().string()
+                                                         : options.temp_dir;
+
+        auto start = high_resolution_clock::now();
+        std::unique_ptr<Information> information;
+        std::unique_ptr<ChunkReader> reader;
+        std::vector<Element> chunk;
+        std::vector<std::unique_ptr<RunFile>> runs;
+        size_t total = 0;
+        bool written = false;  // whether the output is already complete
+        std::exception_ptr failure;  // an I/O error of the root, raised on all processes at the next broadcast
+        if (rank == MASTER) {
+            try {
+                reader = std::make_unique<ChunkReader>(input, options.input_format, textChunk);
+                chunk.resize(capacity);
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+
+        // Sort chunk after chunk; the root tells the others whether there is one more, or whether it failed
+        for (size_t chunks = 0;; chunks++) {
+            size_t count = 0;
+            int state[2] = {0, 0};  // one more chunk, the root failed
+            if (rank == MASTER && failure == nullptr) {
+                try {
+                    count = written ? 0 : reader->read(chunk.data(), capacity);
+                    state[0] = count > 0 || chunks == 0;  // an empty input is one empty chunk
+                } catch (...) {
+                    failure = std::current_exception();
+                }
+            }
+            state[1] = failure != nullptr;
+            MPI_Bcast(state, 2, MPI_INT, MASTER, context.comm);
+            if (failure != nullptr) {
+                std::rethrow_exception(failure);
+            }
+            if (state[1]) {
+                throw std::runtime_error("external_sort: the root failed to read the input or to write a run");
+            }
+            if (!state[0]) {
+                break;
+            }
+
+            auto info = context.mpi_sort(chunk.data(), chunk.data() + count);
+            if (rank != MASTER) {
+                continue;
+            }
+            if (information == nullptr) {
+                information = std::move(info);
+            } else {
+                accumulate(*information, *info);
+            }
+            total += count;
+
+            try {
+                if (count < capacity && runs.empty()) {
+                    // The whole input fits in one chunk, there is nothing to merge
+                    if (options.output_format == Format::Binary) {
+                        write_binary(output, chunk.data(), chunk.data() + count);
+                    } else {
+                        TextWriter writer(output, textChunk);
+                        writer.write(chunk.data(), chunk.data() + count);
+                        writer.close();
+                    }
+                    written = true;
+                } else {
+                    auto run = std::make_unique<RunFile>(directory);
+                    Descriptor file(run->path, O_WRONLY | O_TRUNC);
+                    write_all(file.fd, chunk.data(), count * sizeof(Element), run->path.c_str());
+                    runs.push_back(std::move(run));
+                }
+            } catch (...) {
+                failure = std::current_exception();
+            }
+        }
+        // The slices, blocks and requests mpi_sort kept go too, the merge takes the whole limit
+        context.buffers.clear();
+        context.persistentRequests().clear();
+        if (rank != MASTER) {
+            return information;
+        }
+
+        // The chunk is done with, the merge buffers take its room
+        reader.reset();
+        std::vector<Element>().swap(chunk);
+        if (!written) {
+            // Merge the oldest runs into one until one pass can take them all
+            size_t fanIn = limit / minBuffer - 1;
+            while (runs.size() > fanIn) {
+                auto merged = std::make_unique<RunFile>(directory);
+                {
+                    Descriptor file(merged->path, O_WRONLY | O_TRUNC);
+                    mergeRuns(runs.data(), fanIn, limit / (fanIn + 1), [&](Element *begin, Element *end) {
+                        write_all(file.fd, begin, (end - begin) * sizeof(Element), file.path.c_str());
+                    });
+                }
+                runs.erase(runs.begin(), runs.begin() + static_cast<std::ptrdiff_t>(fanIn));
+                runs.push_back(std::move(merged));
+            }
+
+            size_t bufferSize = limit / (runs.size() + 1);
+            if (options.output_format == Format::Binary) {
+                Descriptor file(output, O_WRONLY | O_CREAT | O_TRUNC);
+                mergeRuns(runs.data(), runs.size(), bufferSize, [&](Element *begin, Element *end) {
+                    to_little_endian(begin, end);
+                    write_all(file.fd, begin, (end - begin) * sizeof(Element), file.path.c_str());
+                });
+            } else {
+                TextWriter writer(output, textChunk);
+                mergeRuns(runs.data(), runs.size(), bufferSize, [&](Element *begin, Element *end) {
+                    writer.write(begin, end);
+                });
+                writer.close();
+            }
+        }
+
+        information->start = start;
+        information->end = high_resolution_clock::now();
+        information->length = total;
+        return information;
+    }
+}
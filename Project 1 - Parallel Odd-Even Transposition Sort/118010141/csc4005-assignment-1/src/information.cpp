@@ -0,0 +1,122 @@
+#include <odd-even-sort.hpp>
+#include <cstring>
+#include <algorithm>
+#include <iomanip>
+#include <ios>
+
+namespace sort {
+    using namespace std::chrono;
+
+    const char *engine_name(Engine engine) {
+        switch (engine) {
+            case Engine::Element:
+                return "element";
+            case Engine::Block:
+                return "block";
+            case Engine::Sample:
+                return "sample";
+            case Engine::Radix:
+                return "radix";
+            case Engine::Bitonic:
+                return "bitonic";
+        }
+        return "unknown";
+    }
+
+    const char *sort_path_name(SortPath path) {
+        switch (path) {
+            case SortPath::Engine:
+                return "engine";
+            case SortPath::Presorted:
+                return "presorted";
+            case SortPath::Adaptive:
+                return "adaptive";
+            case SortPath::AdaptiveEngine:
+                return "adaptive+engine";
+            case SortPath::Counting:
+                return "counting";
+        }
+        return "unknown";
+    }
+
+    bool parse_engine(const char *name, Engine &engine) {
+        for (auto candidate : {Engine::Element, Engine::Block, Engine::Sample, Engine::Radix, Engine::Bitonic}) {
+            if (std::strcmp(name, engine_name(candidate)) == 0) {
+                engine = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const char *phase_name(Phase phase) {
+        switch (phase) {
+            case Phase::Compute:
+                return "compute";
+            case Phase::Exchange:
+                return "exchange";
+            case Phase::Wait:
+                return "wait";
+            case Phase::Distribute:
+                return "distribute";
+        }
+        return "unknown";
+    }
+
+    std::ostream &Context::print_information(const Information &info, std::ostream &output) {
+        auto duration = info.end - info.start;
+        auto duration_count = duration_cast<nanoseconds>(duration).count();
+        output << "Name: Li Jingyu" << std::endl; 
+        output << "Student ID: 118010141" << std::endl;
+        output << "Assignment 1, odd-even sort, MPI implementation" << std::endl;
+        output << "input size: " << info.length << std::endl;
+        output << "element size (bytes): " << info.element_size << std::endl;
+        output << "proc number: " << info.num_of_proc << std::endl;
+        output << "threads per proc: " << info.threads << std::endl;
+        output << "engine: " << engine_name(info.engine) << std::endl;
+        output << "phases: " << info.phases << std::endl;
+        output << "path: " << sort_path_name(info.path) << std::endl;
+        output << "descents: " << info.descents << std::endl;
+        output << "duration (ns): " << duration_count << std::endl;
+        if (!info.ranks.empty()) {
+            // One row per process, then the spread of every phase; imbalance is max / mean
+            std::ios format(nullptr);  // the caller's flags and precision, restored after the table
+            format.copyfmt(output);
+            const int width = 14;
+            PhaseTimes low = info.ranks[0];
+            PhaseTimes high = info.ranks[0];
+            PhaseTimes sum{};
+            output << std::setw(10) << "rank";
+            for (size_t p = 0; p < phase_count; p++) {
+                output << std::setw(width) << phase_name(static_cast<Phase>(p));
+            }
+            output << std::endl;
+            for (size_t r = 0; r < info.ranks.size(); r++) {
+                output << std::setw(10) << r;
+                for (size_t p = 0; p < phase_count; p++) {
+                    output << std::setw(width) << info.ranks[r][p];
+                    low[p] = std::min(low[p], info.ranks[r][p]);
+                    high[p] = std::max(high[p], info.ranks[r][p]);
+                    sum[p] += info.ranks[r][p];
+                }
+                output << std::endl;
+            }
+            output << std::setw(10) << "min";
+            for (size_t p = 0; p < phase_count; p++) {
+                output << std::setw(width) << low[p];
+            }
+            output << std::endl << std::setw(10) << "max";
+            for (size_t p = 0; p < phase_count; p++) {
+                output << std::setw(width) << high[p];
+            }
+            output << std::endl << std::setw(10) << "imbalance";
+            for (size_t p = 0; p < phase_count; p++) {
+                double mean = static_cast<double>(sum[p]) / info.ranks.size();
+                output << std::setw(width) << std::fixed << std::setprecision(2) << (mean > 0 ? high[p] / mean : 1.0);
+            }
+            output << std::endl;
+            output.copyfmt(format);
+        }
+        return output;
+    }
+}
@@ -1,8 +1,49 @@
 #include <odd-even-sort.hpp>
+#include <sort-io.hpp>
+#include <mpi-io.hpp>
+#include <external-sort.hpp>
+#include <batch-sort.hpp>
 #include <mpi.h>
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
-#include <fstream>
 #include <vector>
+#include <cstring>
+#include <exception>
+
+/**!
+ * Parse a number of bytes with an optional K, M or G suffix (powers of 1024).
+ * @param text the text to parse
+ * @param bytes output number of bytes, untouched on failure
+ * @return whether the text is valid
+ */
+bool parseBytes(const char *text, size_t &bytes) {
+    char *end;
+    size_t value = std::strtoull(text, &end, 10);
+    if (end == text) {
+        return false;
+    }
+    switch (*end) {
+        case 'G':
+            value <<= 10;
+            [[fallthrough]];
+        case 'M':
+            value <<= 10;
+            [[fallthrough]];
+        case 'K':
+            value <<= 10;
+            ++end;
+            break;
+        default:
+            break;
+    }
+    if (*end != '\0') {
+        return false;
+    }
+    bytes = value;
+    return true;
+}
 
 int main(int argc, char **argv) {
     sort::Context context(argc, argv);
@@ -14,38 +55,193 @@ int main(int argc, char **argv) {
     if (argc < 3) {
         if (rank == 0) {
             std::cerr << "wrong arguments" << std::endl;
-            std::cerr << "usage: " << argv[0] << " <input-file> <output-file>" << std::endl;
+            std::cerr << "usage: " << argv[0] << " <input-file|input-directory> <output-file|output-directory> [--engine=element|block|sample|radix|bitonic] [--check-interval=<phases>]"
+                      << " [--threads=<per-process>] [--input-format=text|binary] [--output-format=text|binary] [--parallel-io] [--no-adaptive]"
+                      << " [--external] [--memory-limit=<bytes>[K|M|G]] [--temp-dir=<directory>]"
+                      << " [--top=<k>]" << std::endl;
         }
         return 0;
     }
 
-    if (rank == 0) {
-        sort::Element element;
-        std::vector<sort::Element> data;
-        std::ifstream input(argv[1]);
-        std::ofstream output(argv[2]);
-        while (input >> element) {
-            data.push_back(element);
+    sort::Format inputFormat = sort::Format::Text;
+    sort::Format outputFormat = sort::Format::Text;
+    bool parallelIO = false;
+    bool external = false;
+    bool top = false;
+    size_t topCount = 0;
+    sort::ExternalOptions externalOptions;
+    for (int i = 3; i < argc; i++) {
+        if (std::strncmp(argv[i], "--engine=", 9) == 0 && sort::parse_engine(argv[i] + 9, context.engine)) {
+            continue;
         }
-        int dataSize = data.size();
-        if (dataSize < size) {  // data < process number 
-            for (int i = 0; i < (size - dataSize); i++) {
-                data.push_back(RAND_MAX);
-            }
+        if (std::strncmp(argv[i], "--check-interval=", 17) == 0) {
+            context.check_interval = std::atoi(argv[i] + 17);
+            continue;
+        }
+        if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+            context.threads = std::atoi(argv[i] + 10);
+            continue;
+        }
+        if (std::strncmp(argv[i], "--input-format=", 15) == 0 && sort::parse_format(argv[i] + 15, inputFormat)) {
+            continue;
+        }
+        if (std::strncmp(argv[i], "--output-format=", 16) == 0 && sort::parse_format(argv[i] + 16, outputFormat)) {
+            continue;
+        }
+        if (std::strcmp(argv[i], "--parallel-io") == 0) {
+            parallelIO = true;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--no-adaptive") == 0) {
+            context.adaptive = false;
+            continue;
+        }
+        if (std::strcmp(argv[i], "--external") == 0) {
+            external = true;
+            continue;
+        }
+        if (std::strncmp(argv[i], "--memory-limit=", 15) == 0 && parseBytes(argv[i] + 15, externalOptions.memory_limit)) {
+            continue;
+        }
+        if (std::strncmp(argv[i], "--temp-dir=", 11) == 0) {
+            externalOptions.temp_dir = argv[i] + 11;
+            continue;
+        }
+        if (std::strncmp(argv[i], "--top=", 6) == 0) {
+            top = true;
+            topCount = std::strtoull(argv[i] + 6, nullptr, 10);
+            continue;
+        }
+        if (rank == 0) {
+            std::cerr << "unknown option: " << argv[i] << std::endl;
+        }
+        return 0;
+    }
+
+    if (external && parallelIO) {
+        if (rank == 0) {
+            std::cerr << "--external and --parallel-io do not combine" << std::endl;
+        }
+        return 0;
+    }
+    if (top && (external || parallelIO)) {
+        if (rank == 0) {
+            std::cerr << "--top combines with neither --external nor --parallel-io" << std::endl;
         }
+        return 0;
+    }
 
-        auto info = context.mpi_sort(data.data(), data.data() + data.size());
-        info->length = dataSize;
-        sort::Context::print_information(*info, std::cout);
-        int count = 1;
-        for (int i = 0; i < dataSize; i++) {
-            output << data[i] << " ";
-            if (count++ % 20 == 0) {
-                output << std::endl;
+    // Only the root needs to see the input, it tells the others whether it is a directory
+    int batch = rank == 0 && std::filesystem::is_directory(argv[1]);
+    MPI_Bcast(&batch, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    if (batch && (external || parallelIO || top)) {
+        if (rank == 0) {
+            std::cerr << "a directory of inputs combines with none of --external, --parallel-io and --top" << std::endl;
+        }
+        return 0;
+    }
+
+    // A file that cannot be read or written throws; stop every process rather than dump core
+    try {
+        if (batch) {
+            // Every file of the directory, read and written by the root while the one between them is sorted
+            std::vector<std::string> inputs;
+            std::vector<std::string> outputs;
+            if (rank == 0) {
+                std::filesystem::create_directories(argv[2]);
+                for (const auto &entry : std::filesystem::directory_iterator(argv[1])) {
+                    if (entry.is_regular_file()) {
+                        inputs.push_back(entry.path().string());
+                    }
+                }
+                std::sort(inputs.begin(), inputs.end());
+                for (const auto &input : inputs) {
+                    auto name = std::filesystem::path(input).filename();
+                    outputs.push_back((std::filesystem::path(argv[2]) / name).string());
+                }
+            }
+            sort::BatchOptions batchOptions;
+            batchOptions.input_format = inputFormat;
+            batchOptions.output_format = outputFormat;
+            auto start = std::chrono::high_resolution_clock::now();
+            auto infos = sort::batch_sort(context, inputs, outputs, batchOptions);
+            auto duration = std::chrono::high_resolution_clock::now() - start;
+            if (rank == 0) {
+                int64_t sorting = 0;
+                for (size_t i = 0; i < infos.size(); i++) {
+                    std::cout << "file: " << inputs[i] << std::endl;
+                    sort::Context::print_information(*infos[i], std::cout);
+                    auto elapsed = infos[i]->end - infos[i]->start;
+                    sorting += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+                }
+                std::cout << "files: " << infos.size() << std::endl;
+                std::cout << "sort duration (ns): " << sorting << std::endl;
+                std::cout << "batch duration (ns): "
+                          << std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count() << std::endl;
+            }
+        } else if (external) {
+            // The root streams the input through bounded chunks, the others help sort every chunk
+            externalOptions.input_format = inputFormat;
+            externalOptions.output_format = outputFormat;
+            auto info = sort::external_sort(context, argv[1], argv[2], externalOptions);
+            if (rank == 0) {
+                sort::Context::print_information(*info, std::cout);
+            }
+        } else if (parallelIO) {
+            // Every process reads, sorts and writes its own slice of the binary files
+            auto local = sort::mpi_read_binary(argv[1]);
+            auto info = context.mpi_sort_distributed(local);
+            sort::mpi_write_binary(argv[2], local);
+            if (rank == 0) {
+                sort::Context::print_information(*info, std::cout);
+            }
+        } else if (rank == 0) {
+            // Binary input is sorted right in its (private) mapping, text is parsed into a vector
+            sort::MappedArray mapped;
+            std::vector<sort::Element> parsed;
+            sort::Element *begin;
+            sort::Element *end;
+            if (inputFormat == sort::Format::Binary) {
+                mapped = sort::MappedArray::open(argv[1]);
+                begin = mapped.begin();
+                end = mapped.end();
+            } else {
+                parsed = sort::read_text(argv[1]);
+                begin = parsed.data();
+                end = parsed.data() + parsed.size();
             }
-            // std::cout << i << " ";
+
+            if (top) {
+                // Only the first k elements, selected without sorting the rest
+                std::vector<sort::Element> output;
+                auto info = context.mpi_topk(begin, end, topCount, output);
+                sort::Context::print_information(*info, std::cout);
+                begin = output.data();
+                end = output.data() + output.size();
+                if (outputFormat == sort::Format::Binary) {
+                    sort::write_binary(argv[2], begin, end);
+                } else {
+                    sort::write_text(argv[2], begin, end);
+                }
+                return 0;
+            }
+            auto info = context.mpi_sort(begin, end);
+            sort::Context::print_information(*info, std::cout);
+            if (outputFormat == sort::Format::Binary) {
+                sort::write_binary(argv[2], begin, end);
+            } else {
+                sort::write_text(argv[2], begin, end);
+            }
+        } else if (top) {
+            std::vector<sort::Element> output;
+            context.mpi_topk<sort::Element>(nullptr, nullptr, 0, output);
+        } else {
+            context.mpi_sort(nullptr, nullptr);
+        }
+    } catch (const std::exception &error) {
+        if (rank == 0) {
+            std::cerr << error.what() << std::endl;
         }
-    } else {
-        context.mpi_sort(nullptr, nullptr);
+        MPI_Abort(MPI_COMM_WORLD, 1);
     }
 }
@@ -0,0 +1,91 @@
+#include <mpi-io.hpp>
+#include <sort-io.hpp>
+#include <mpi.h>
+#include <stdexcept>
+#include <string>
+#include <climits>
+#include <algorithm>
+
+namespace sort {
+    namespace {
+        MPI_File openFile(const char *path, int mode) {
+            MPI_File file;
+            if (MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, path, mode, MPI_INFO_NULL, &file)) {
+                throw std::runtime_error(std::string("failed to open ") + path);
+            }
+            return file;
+        }
+
+        /**!
+         * Collective read or write of count elements at an element offset, in calls of at
+         * most INT_MAX elements. Every process runs as many calls as the largest slice needs.
+         * @param file the open file
+         * @param first element offset of the slice
+         * @param data the slice
+         * @param count number of elements in the slice
+         * @param write whether to write instead of read
+         */
+        void transferAll(MPI_File file, long long first, Element *data, long long count, bool write) {
+            long long rounds = (count + INT_MAX - 1) / INT_MAX;
+            long long maxRounds;
+            MPI_Allreduce(&rounds, &maxRounds, 1, MPI_LONG_LONG, MPI_MAX, MPI_COMM_WORLD);
+            for (long long i = 0; i < maxRounds; i++) {
+                long long offset = std::min(i * INT_MAX, count);
+                int piece = static_cast<int>(std::min<long long>(INT_MAX, count - offset));
+                MPI_Offset position = (first + offset) * sizeof(Element);
+                if (write) {
+                    MPI_File_write_at_all(file, position, data + offset, piece, MPI_INT64_T, MPI_STATUS_IGNORE);
+                } else {
+                    MPI_File_read_at_all(file, position, data + offset, piece, MPI_INT64_T, MPI_STATUS_IGNORE);
+                }
+            }
+        }
+    }
+
+    std::vector<Element> mpi_read_binary(const char *path) {
+        int rank;
+        int size;
+        MPI_Offset bytes;
+
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+        MPI_File file = openFile(path, MPI_MODE_RDONLY);
+        MPI_File_get_size(file, &bytes);
+        if (bytes % static_cast<MPI_Offset>(sizeof(Element)) != 0) {
+            MPI_File_close(&file);
+            throw std::runtime_error(std::string("binary input is not a whole number of elements: ") + path);
+        }
+
+        long long totalCount = bytes / sizeof(Element);
+        long long first = rank * totalCount / size;
+        long long last = (rank + 1) * totalCount / size;
+        std::vector<Element> local(last - first);
+        transferAll(file, first, local.data(), last - first, false);
+        MPI_File_close(&file);
+
+        to_little_endian(local.data(), local.data() + local.size());
+        return local;
+    }
+
+    void mpi_write_binary(const char *path, std::vector<Element> &local) {
+        int rank;
+        long long localCount = static_cast<long long>(local.size());
+        long long first = 0;
+        long long totalCount;
+
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+        MPI_Exscan(&localCount, &first, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (rank == 0) {
+            first = 0;
+        }
+        MPI_Allreduce(&localCount, &totalCount, 1, MPI_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+
+        to_little_endian(local.data(), local.data() + local.size());
+        MPI_File file = openFile(path, MPI_MODE_WRONLY | MPI_MODE_CREATE);
+        MPI_File_set_size(file, totalCount * sizeof(Element));  // drop the tail of an older, longer file
+        transferAll(file, first, local.data(), localCount, true);
+        MPI_File_close(&file);
+    }
+}
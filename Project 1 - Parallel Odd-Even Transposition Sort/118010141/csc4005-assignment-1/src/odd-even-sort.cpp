@@ -1,203 +1,702 @@
 #include <odd-even-sort.hpp>
+#include <sort-kernels.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <thread-team.hpp>
+#include <merge-range.hpp>
 #include <mpi.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+#include <bit>
 
 #define MASTER 0
 
 namespace sort {
     using namespace std::chrono;
 
+    namespace {
+        constexpr size_t minThreadWork = 1 << 14;  // elements per thread below which a team costs more than it saves
+        constexpr size_t adaptiveRunLength = 32;  // average run length from which a slice counts as presorted
+        constexpr size_t maxMergeRuns = 64;  // runs merged naturally, more are sorted by insertion
+        constexpr size_t insertionBudget = 8;  // element moves per element before insertion gives up
+
+        /**!
+         * Run body(first, last) over [0, count), split among the members of a team.
+         * @param team the team, null to run everything on the caller
+         * @param count number of items
+         * @param body the work on a range of items
+         */
+        template<typename Body>
+        void forRanges(ThreadTeam *team, size_t count, Body body) {
+            if (team == nullptr) {
+                body(size_t{0}, count);
+                return;
+            }
+            team->run([&](int id) {
+                body(team->first(id, count), team->first(id + 1, count));
+            });
+        }
+
+        /**!
+         * Sort a presorted array: merge its runs pairwise when there are few of them,
+         * otherwise insertion sort, which costs one move per inversion. Insertion gives up
+         * after insertionBudget moves per element and sorts the rest with std::sort.
+         * @param array the elements
+         * @param count number of elements
+         * @param descents number of descents in the array, i.e. runs - 1
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void adaptiveSort(T *array, size_t count, size_t descents, Compare compare) {
+            if (descents == 0) {
+                return;
+            }
+            if (descents < maxMergeRuns) {
+                std::vector<size_t> starts{0};
+                for (size_t i = 1; i < count; i++) {
+                    if (compare(array[i], array[i - 1])) {
+                        starts.push_back(i);
+                    }
+                }
+                starts.push_back(count);
+                while (starts.size() > 2) {
+                    std::vector<size_t> merged{0};
+                    for (size_t r = 0; r + 2 < starts.size(); r += 2) {
+                        std::inplace_merge(array + starts[r], array + starts[r + 1], array + starts[r + 2], compare);
+                        merged.push_back(starts[r + 2]);
+                    }
+                    if (merged.back() != count) {  // an odd run out waits for the next round
+                        merged.push_back(count);
+                    }
+                    starts.swap(merged);
+                }
+                return;
+            }
+            size_t budget = insertionBudget * count;
+            size_t moves = 0;
+            for (size_t i = 1; i < count; i++) {
+                if (!compare(array[i], array[i - 1])) {
+                    continue;
+                }
+                T value = std::move(array[i]);
+                size_t j = i;
+                for (; j > 0 && compare(value, array[j - 1]); j--) {
+                    array[j] = std::move(array[j - 1]);
+                }
+                array[j] = std::move(value);
+                moves += i - j;
+                if (moves > budget) {  // further apart than it looked, [0, i] is sorted at least
+                    std::sort(array + i + 1, array + count, compare);
+                    std::inplace_merge(array, array + i + 1, array + count, compare);
+                    return;
+                }
+            }
+        }
+    }
 
     Context::Context(int &argc, char **&argv) : argc(argc), argv(argv) {
-        MPI_Init(&argc, &argv);
+        int provided;
+        // Only the thread that called this one makes MPI calls, team members never do
+        MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided);
     }
 
     Context::~Context() {
+        team.reset();
+        requests.reset();  // persistent requests are freed while MPI is still up
+        if (cube_key != MPI_KEYVAL_INVALID) {
+            // Hypercubes of communicators freed before this one are gone already
+            for (MPI_Comm cached : {comm, MPI_COMM_WORLD}) {
+                void *cube;
+                int found;
+                MPI_Comm_get_attr(cached, cube_key, &cube, &found);
+                if (found) {
+                    MPI_Comm_delete_attr(cached, cube_key);
+                }
+            }
+            MPI_Comm_free_keyval(&cube_key);
+        }
         MPI_Finalize();
     }
 
+    ThreadTeam *Context::threadTeam(size_t work) const {
+        if (threads <= 1 || work < threads * minThreadWork) {
+            return nullptr;
+        }
+        if (!team || team->size() != threads) {
+            team = std::make_unique<ThreadTeam>(threads);
+        }
+        return team.get();
+    }
+
+    Engine Context::engineFor(int size) const {
+        if (engine == Engine::Bitonic && !std::has_single_bit(static_cast<unsigned>(size))) {
+            return Engine::Block;  // the same merge-split, between neighbours in a chain
+        }
+        return engine;
+    }
+
+    RequestCache &Context::persistentRequests() const {
+        if (!requests) {
+            requests = std::make_unique<RequestCache>();
+        }
+        return *requests;
+    }
+
+    template<typename T, typename Compare>
+    void Context::localSort(T* localArray, size_t localCount, Compare compare) const {
+        if (std::is_sorted(localArray, localArray + localCount, compare)) {
+            return;  // e.g. after the adaptive pre-pass; a random slice is told apart in a few elements
+        }
+        ThreadTeam *members = threadTeam(localCount);
+        if (members == nullptr) {
+            std::sort(localArray, localArray + localCount, compare);
+            return;
+        }
+        // Every member sorts its part, then neighbouring runs are merged pairwise
+        int parts = members->size();
+        auto part = [&](int id) { return localArray + members->first(id, localCount); };
+        members->run([&](int id) {
+            std::sort(part(id), part(id + 1), compare);
+        });
+        for (int width = 1; width < parts; width *= 2) {
+            members->run([&](int id) {
+                if (id % (2 * width) == 0 && id + width < parts) {
+                    std::inplace_merge(part(id), part(id + width), part(std::min(id + 2 * width, parts)), compare);
+                }
+            });
+        }
+    }
+
     void Context::swapE(Element* first, Element* second) const {
         Element temp = *second;
         *second = *first;
         *first = temp;
     }
 
-    void Context::oddSort(Element* localArray, int localCount) const {
-        for (int j = 0; j < localCount - 1; j += 2) {
-            if (*(localArray + j) > *(localArray + j + 1)) {
-                swapE(localArray + j, localArray + j + 1);
-            }
+    template<typename T, typename Compare>
+    bool Context::oddSort(T* localArray, size_t localCount, Compare compare) const {
+        return compare_exchange(localArray, localCount, compare);
+    }
+
+    template<typename T, typename Compare>
+    bool Context::evenSort(T* localArray, size_t localCount, Compare compare) const {
+        return localCount > 1 && compare_exchange(localArray + 1, localCount - 1, compare);
+    }
+
+    int Context::checkInterval(int defaultInterval) const {
+        if (check_interval < 0) {
+            return 0;
         }
+        // One quiet phase proves nothing, a quiet odd phase followed by a quiet even phase does
+        return std::max(check_interval == 0 ? defaultInterval : check_interval, 2);
     }
 
-    void Context::evenSort(Element* localArray, int localCount) const {
-        for (int j = 1; j < localCount - 1; j += 2) {
-            if (*(localArray + j) > *(localArray + j + 1)) {
-                swapE(localArray + j, localArray + j + 1);
+    bool Context::converged(bool &swapped, size_t phases, int interval) const {
+        if (interval == 0 || phases % interval != 0) {
+            return false;
+        }
+        int local = swapped;
+        int global;
+        PhaseScope scope(clock, Phase::Wait);
+        MPI_Allreduce(&local, &global, 1, MPI_INT, MPI_LOR, comm);
+        swapped = false;  // start a new batch
+        return !global;
+    }
+
+    template<typename T, typename Compare>
+    size_t Context::elementSort(T* localArray, size_t localCount, size_t totalCount, Compare compare) const {
+        int rank;
+        int size;
+        size_t phases = 0;
+        int interval = checkInterval(64);  // a phase is cheap here, so check rarely
+        bool swapped = false;  // whether this process changed anything since the last check
+        MPI_Datatype type = mpi_type<T>();
+        RequestCache &persistent = persistentRequests();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        // The traded elements: from the previous process, from the next one
+        std::vector<T> &buffer = buffers.get<T>(BufferPool::Ends);
+        buffer.resize(2);
+
+        // Locate this slice in the global array; the neighbours are the closest
+        // processes that hold elements, empty processes only join the checks
+        std::vector<uint64_t> &counts = buffers.get<uint64_t>(BufferPool::Sizes);
+        counts.resize(size);
+        uint64_t count = localCount;
+        {
+            PhaseScope scope(clock, Phase::Wait);
+            MPI_Allgather(&count, 1, MPI_UINT64_T, counts.data(), 1, MPI_UINT64_T, comm);
+        }
+        size_t previous = 0;  // number of elements on lower ranks
+        for (int r = 0; r < rank; r++) {
+            previous += counts[r];
+        }
+        int prev = rank - 1;
+        while (prev >= 0 && counts[prev] == 0) {
+            prev--;
+        }
+        int next = rank + 1;
+        while (next < size && counts[next] == 0) {
+            next++;
+        }
+
+        // With a team, member 0 trades the boundary elements while all members run the local
+        // pairs; the boundary elements are never part of a local pair in the same phase
+        ThreadTeam *members = threadTeam(localCount);
+        std::vector<char> memberSwapped(members ? members->size() : 0);
+
+        for (size_t i = 0; i < totalCount; i++) {  // At most totalCount phases
+            // The first element pairs with the last one of the previous process
+            bool left = localCount > 0 && previous % 2 != i % 2;
+            // The last element pairs with the first one of the next process, which keeps the smaller
+            bool right = localCount > 0 && (previous + localCount - 1) % 2 == i % 2 && next < size;
+
+            // The same trades repeat every other phase, so they are persistent requests
+            auto exchange = [&] {
+                PhaseScope scope(clock, Phase::Exchange);  // on member 0, the thread that owns the clock
+                if (left && prev >= 0) {
+                    MPI_Request receive = persistent.recv(&buffer[0], 1, type, prev, MASTER, comm);
+                    MPI_Start(&receive);
+                    MPI_Wait(&receive, MPI_STATUS_IGNORE);
+                    if (compare(localArray[0], buffer[0])) {
+                        std::swap(buffer[0], localArray[0]);
+                        swapped = true;
+                    }
+                    MPI_Request reply = persistent.send(&buffer[0], 1, type, prev, MASTER, comm);
+                    MPI_Start(&reply);
+                    MPI_Wait(&reply, MPI_STATUS_IGNORE);
+                }
+                if (right) {
+                    MPI_Request trade[2] = {persistent.send(localArray + localCount - 1, 1, type, next, MASTER, comm),
+                                            persistent.recv(&buffer[1], 1, type, next, MASTER, comm)};
+                    MPI_Startall(2, trade);
+                    MPI_Waitall(2, trade, MPI_STATUSES_IGNORE);
+                    localArray[localCount - 1] = buffer[1];
+                }
+            };
+
+            if (localCount == 0) {
+                // Nothing here, only join the checks
+            } else if (members == nullptr) {
+                swapped |= left ? evenSort(localArray, localCount, compare) : oddSort(localArray, localCount, compare);
+                exchange();
+            } else {
+                size_t offset = left ? 1 : 0;
+                size_t pairs = (localCount - offset) / 2;
+                members->run([&](int id) {
+                    if (id == 0) {
+                        exchange();
+                    }
+                    size_t first = members->first(id, pairs);
+                    size_t last = members->first(id + 1, pairs);
+                    memberSwapped[id] = compare_exchange(localArray + offset + 2 * first, 2 * (last - first), compare);
+                });
+                for (char memberSwap : memberSwapped) {
+                    swapped |= memberSwap;
+                }
+            }
+
+            phases = i + 1;
+            if (converged(swapped, phases, interval)) {
+                break;
             }
         }
+        return phases;
     }
 
-    std::unique_ptr<Information> Context::mpi_sort(Element *begin, Element *end) const {
-        int res;
+    template<typename T, typename Compare>
+    size_t Context::mergeSplit(T* localArray, size_t localCount, const T *remote, size_t remoteCount,
+                               size_t blockCount, bool localFirst, bool keepLower, T *merged, Compare compare) const {
+        size_t total = localCount + remoteCount;
+        size_t count;
+        size_t first;  // merged position of the first element kept
+        if (keepLower) {  // padding goes to the partner first
+            count = std::min(total, blockCount);
+            first = 0;
+        } else {  // the upper half takes the padding
+            count = total > blockCount ? total - blockCount : 0;
+            first = total - count;
+        }
+        const T *lower = localFirst ? localArray : remote;
+        const T *upper = localFirst ? remote : localArray;
+        size_t lowerCount = localFirst ? localCount : remoteCount;
+        size_t upperCount = localFirst ? remoteCount : localCount;
+        forRanges(threadTeam(blockCount), count, [&](size_t from, size_t to) {
+            merge_range(lower, lowerCount, upper, upperCount, first + from, first + to, merged + from, compare);
+        });
+        std::copy(merged, merged + count, localArray);
+        return count;
+    }
+
+    template<typename T, typename Compare>
+    size_t Context::blockSort(T* localArray, size_t &localCount, size_t blockCount, Compare compare) const {
         int rank;
         int size;
-        int totalCount;  // total number of elements
-        int localCount;  // the number of local array elements
-        int remain;
+        size_t remoteCount;
+        size_t phases = 0;
+        int interval = checkInterval(2);  // a phase moves a whole block, a check is cheap next to it
+        bool swapped = false;  // whether this process changed anything since the last check
+        MPI_Datatype type = mpi_type<T>();
 
-        Element buffer;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
 
-        Element* localArray;
+        std::vector<T> &remote = buffers.get<T>(BufferPool::Remote);
+        std::vector<T> &merged = buffers.get<T>(BufferPool::Merged);
+        remote.resize(blockCount);
+        merged.resize(blockCount);
 
-        std::unique_ptr<Information> information{};
+        localSort(localArray, localCount, compare);
 
-        res = MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-        if (MPI_SUCCESS != res) {
-            throw std::runtime_error("failed to get MPI world rank");
+        // Every block is logically padded to blockCount with +inf, so that the classic
+        // result holds: size phases of merge-split over equal blocks sort the whole array.
+        for (int i = 0; i < size; i++) {
+            int partner = (i % 2 == rank % 2) ? rank + 1 : rank - 1;
+            if (partner >= 0 && partner < size) {  // otherwise no neighbour in this phase
+                {
+                    PhaseScope scope(clock, Phase::Exchange);
+                    remoteCount = sendrecv(localArray, localCount, remote.data(), blockCount, type, partner, MASTER,
+                                           comm, chunk_limit, &persistentRequests());
+                }
+                // Moving padding counts as a change too, an empty block may hide an inversion
+                size_t before = localCount;
+                bool crossed = localCount > 0 && remoteCount > 0 &&
+                               (rank < partner ? compare(remote[0], localArray[localCount - 1])
+                                               : compare(localArray[0], remote[remoteCount - 1]));
+                // The lower block keeps the lower half, and its equal elements go first
+                localCount = mergeSplit(localArray, localCount, remote.data(), remoteCount, blockCount,
+                                        rank < partner, rank < partner, merged.data(), compare);
+                swapped |= crossed || localCount != before;
+            }
+
+            phases = i + 1;
+            if (converged(swapped, phases, interval)) {
+                break;
+            }
         }
-        res = MPI_Comm_size(MPI_COMM_WORLD, &size);
-        if (MPI_SUCCESS != res) {
-            throw std::runtime_error("failed to get MPI world size");
+        return phases;
+    }
+
+    template<typename T, typename Compare>
+    uint64_t Context::boundaryDescents(const T *localArray, size_t localCount, Compare compare) const {
+        int size;
+        MPI_Comm_size(comm, &size);
+        uint64_t count = localCount;
+        T ends[2]{};
+        if (localCount > 0) {
+            ends[0] = localArray[0];
+            ends[1] = localArray[localCount - 1];
+        }
+        std::vector<uint64_t> &counts = buffers.get<uint64_t>(BufferPool::Sizes);
+        std::vector<T> &allEnds = buffers.get<T>(BufferPool::Ends);
+        counts.resize(size);
+        allEnds.resize(2 * size);
+        {
+            PhaseScope scope(clock, Phase::Wait);
+            MPI_Allgather(&count, 1, MPI_UINT64_T, counts.data(), 1, MPI_UINT64_T, comm);
+            MPI_Allgather(ends, 2, mpi_type<T>(), allEnds.data(), 2, mpi_type<T>(), comm);
+        }
+        uint64_t descents = 0;
+        const T *last = nullptr;  // last element of the closest non-empty slice so far
+        for (int r = 0; r < size; r++) {
+            if (counts[r] == 0) {
+                continue;
+            }
+            if (last != nullptr && compare(allEnds[2 * r], *last)) {
+                descents++;
+            }
+            last = &allEnds[2 * r + 1];
+        }
+        return descents;
+    }
+
+    template<typename T, typename Compare>
+    SortPath Context::choosePath(const T *localArray, size_t localCount, Compare compare, size_t &localDescents,
+                                 uint64_t &descents) const {
+        int size;
+        MPI_Comm_size(comm, &size);
+
+        // Past the limit the slice is not presorted; random input gets there within a few dozen elements
+        size_t limit = localCount / adaptiveRunLength;
+        localDescents = 0;
+        for (size_t i = 1; i < localCount && localDescents <= limit; i++) {
+            localDescents += compare(localArray[i], localArray[i - 1]);
         }
+        uint64_t mine[2] = {localDescents, localDescents <= limit};
+        std::vector<uint64_t> &all = buffers.get<uint64_t>(BufferPool::Sizes);
+        all.resize(2 * size);
+        {
+            PhaseScope scope(clock, Phase::Wait);
+            MPI_Allgather(mine, 2, MPI_UINT64_T, all.data(), 2, MPI_UINT64_T, comm);
+        }
+        bool counted = true;
+        descents = 0;
+        for (int r = 0; r < size; r++) {
+            descents += all[2 * r];
+            counted = counted && all[2 * r + 1] != 0;
+        }
+        if (!counted) {
+            return SortPath::Engine;
+        }
+        descents += boundaryDescents(localArray, localCount, compare);
+        return descents == 0 ? SortPath::Presorted : SortPath::Adaptive;
+    }
+
+    template<typename T, typename Compare>
+    size_t Context::distributedSort(std::vector<T> &local, size_t totalCount, Compare compare, SortPath &path,
+                                    uint64_t &descents) const {
+        size_t localCount = local.size();
+        size_t phases = 0;
+        std::vector<T> &bucket = buffers.get<T>(BufferPool::Bucket);
 
+        path = SortPath::Engine;
+        descents = 0;
+        if (adaptive) {
+            size_t localDescents;
+            path = choosePath(local.data(), localCount, compare, localDescents, descents);
+            if (path == SortPath::Presorted) {
+                return 0;
+            }
+            if (path == SortPath::Adaptive) {
+                adaptiveSort(local.data(), localCount, localDescents, compare);
+                if (boundaryDescents(local.data(), localCount, compare) == 0) {
+                    return 0;
+                }
+                // The slices overlap; the engine sorts them again, which is cheap now
+                path = SortPath::AdaptiveEngine;
+            } else if (distinctKeySort(local, totalCount, compare)) {
+                path = SortPath::Counting;
+                return 0;
+            }
+        }
+
+        int size;
+        MPI_Comm_size(comm, &size);
+        Engine resolved = engineFor(size);
+        switch (resolved) {
+            case Engine::Element:
+                phases = elementSort(local.data(), localCount, totalCount, compare);
+                break;
+            case Engine::Block:
+            case Engine::Bitonic: {
+                uint64_t count = localCount;
+                uint64_t blockCount;
+                {
+                    PhaseScope scope(clock, Phase::Wait);
+                    MPI_Allreduce(&count, &blockCount, 1, MPI_UINT64_T, MPI_MAX, comm);
+                }
+                local.resize(blockCount);  // every block may grow to the size of the largest one
+                phases = resolved == Engine::Block ? blockSort(local.data(), localCount, blockCount, compare)
+                                                   : bitonicSort(local.data(), localCount, blockCount, compare);
+                local.resize(localCount);
+                break;
+            }
+            case Engine::Sample:
+                sampleSort(local.data(), localCount, bucket, compare);
+                local.swap(bucket);
+                break;
+            case Engine::Radix:
+                radixSort(local.data(), localCount, totalCount, bucket, compare);
+                local.swap(bucket);
+                break;
+        }
+        return phases;
+    }
+
+    template<typename T>
+    void Context::scatterSlices(const T *begin, uint64_t &totalCount, std::vector<T> &local,
+                                std::vector<size_t> &counts, std::vector<size_t> &displs) const {
+        int rank;
+        int size;
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        // Broadcast total number count; the other processes wait here until the root is ready
+        clock.enter(Phase::Wait);
+        MPI_Bcast(&totalCount, 1, MPI_UINT64_T, MASTER, comm);
+        clock.enter(Phase::Distribute);
+
+        counts.resize(size);
+        displs.resize(size);
+        for (int i = 0; i < size; i++) {
+            displs[i] = i * totalCount / size;
+            counts[i] = (i + 1) * totalCount / size - displs[i];
+        }
+        local.resize(counts[rank]);
+
+        // Every slice lands in place, the root's included
+        scatterv(begin, counts, displs, local.data(), local.size(), mpi_type<T>(), MASTER, comm, chunk_limit, buffers);
+        clock.enter(Phase::Compute);
+    }
+
+    std::unique_ptr<Information> Context::newInformation(int rank, int size, size_t length, size_t elementSize) const {
+        std::unique_ptr<Information> information{};
         if (rank == MASTER) {
             information = std::make_unique<Information>();
-            information->length = end - begin;
+            information->length = length;
+            information->element_size = elementSize;
             information->num_of_proc = size;
+            information->engine = engineFor(size);
+            information->threads = std::max(threads, 1);
             information->argc = argc;
             for (auto i = 0; i < argc; ++i) {
                 information->argv.push_back(argv[i]);
             }
             information->start = high_resolution_clock::now();
+        }
+        return information;
+    }
 
-            totalCount = information->length;
+    void Context::finishInformation(Information *information, size_t phases) const {
+        if (information != nullptr) {
+            information->end = high_resolution_clock::now();
+            information->phases = phases;
         }
+#if SORT_INSTRUMENT
+        int size;
+        MPI_Comm_size(comm, &size);
+        PhaseTimes times = clock.read();
+        std::vector<PhaseTimes> ranks(information != nullptr ? size : 0);
+        MPI_Gather(times.data(), phase_count, MPI_INT64_T, ranks.data(), phase_count, MPI_INT64_T, MASTER, comm);
+        if (information != nullptr) {
+            information->ranks = std::move(ranks);
+        }
+#endif
+    }
 
-        // Broadcast total number count
-        MPI_Bcast(&totalCount, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> Context::mpi_sort(T *begin, T *end, Compare compare) const {
+        int res;
+        int rank;
+        int size;
+        uint64_t totalCount = 0;  // total number of elements, known at the root only
 
-        localCount = totalCount / size;
-        remain = totalCount - localCount * size;
+        res = MPI_Comm_rank(comm, &rank);
+        if (MPI_SUCCESS != res) {
+            throw std::runtime_error("failed to get MPI rank");
+        }
+        res = MPI_Comm_size(comm, &size);
+        if (MPI_SUCCESS != res) {
+            throw std::runtime_error("failed to get MPI size");
+        }
 
+        clock.reset();
+        auto information = newInformation(rank, size, end - begin, sizeof(T));
         if (rank == MASTER) {
-            localCount += remain;
+            totalCount = information->length;
         }
 
-        // Malloc the space to store local elements
-        localArray = (Element*)malloc(localCount*sizeof(Element));
+        SortPath path;
+        uint64_t descents;
+        size_t phases = scatterSort(begin, totalCount, compare, path, descents);
 
-        // Distribute all the numbers into the slave processes evenly
-        MPI_Scatter(begin + remain, totalCount / size, MPI_LONG, localArray, totalCount / size, MPI_LONG, MASTER, MPI_COMM_WORLD);
+        clock.enter(Phase::Wait);
+        MPI_Barrier(comm);
 
-        // Move the number in the root process to normal order
-        if (rank == MASTER && remain != 0) {
-            for (int i = localCount - 1; i >= 0; i--) {
-                *(localArray + i) = *(localArray + i - remain); 
-            }
-            for (int i = 0; i < remain; i++) {
-                *(localArray + i) = *(begin + i);
-            }
+        finishInformation(information.get(), phases);
+        if (information) {
+            information->path = path;
+            information->descents = descents;
         }
-        
-        // std::cout << "I am process " << rank << std::endl;
-        // for (int i = 0; i < localCount; i++) {
-        //     std::cout << localArray[i] << std::endl;
-        // }
+        return information;
+    }
 
-        // Start odd-even sort
-        for (int i = 0; i < totalCount; i++) {  // Fixed times sorting
-            // Divide the case by rank number
-            if (rank == MASTER) {
-                if (i % 2 == 0) {  // odd phase 
-                    oddSort(localArray, localCount);
-                } else {  // even phase
-                    evenSort(localArray, localCount);
-                }
-                
-                if (localCount % 2 != i % 2 && size > 1) {  // Will send a number
-                    MPI_Send(localArray + localCount - 1, 1, MPI_LONG, 1, MASTER, MPI_COMM_WORLD);
-                    MPI_Recv(&buffer, 1, MPI_LONG, 1, MASTER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    *(localArray + localCount - 1) = buffer;
-                }
-            } else if (rank < size - 1) {
-                int previous = localCount * rank + remain;
-                if (previous % 2 == i % 2) {  // The number of previous elements is even
-                    oddSort(localArray, localCount);
-                    if (localCount % 2 == 1) {  // need to send a number to next process
-                        MPI_Send(localArray + localCount - 1, 1, MPI_LONG, rank + 1, MASTER, MPI_COMM_WORLD);
-                        MPI_Recv(&buffer, 1, MPI_LONG, rank + 1, MASTER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                        *(localArray + localCount - 1) = buffer;
-                    }
-                } else {  // The number of previous elements is odd, receive one from last process
-                    evenSort(localArray, localCount);
-                    MPI_Recv(&buffer, 1, MPI_LONG, rank - 1, MASTER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    if (buffer > localArray[0]) {
-                        swapE(&buffer, localArray);
-                    }                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                                            
-                    MPI_Send(&buffer, 1, MPI_LONG, rank - 1, MASTER, MPI_COMM_WORLD);
-                    if (localCount % 2 == 0 && localCount > 1) { // even element, need to send one to the next process 
-                        MPI_Send(localArray + localCount - 1, 1, MPI_LONG, rank + 1, MASTER, MPI_COMM_WORLD);
-                        MPI_Recv(&buffer, 1, MPI_LONG, rank + 1, MASTER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                        *(localArray + localCount - 1) = buffer;
-                    }
-                }
-            } else {  // The last process
-                int previous = localCount * rank + remain;
-                if (previous % 2 == i % 2) {  // No element from previous processes
-                    oddSort(localArray, localCount);
-                } else {
-                    evenSort(localArray, localCount);
-                    MPI_Recv(&buffer, 1, MPI_LONG, rank - 1, MASTER, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
-                    if (buffer > localArray[0]) {
-                        swapE(&buffer, localArray);
-                    }
-                    MPI_Send(&buffer, 1, MPI_LONG, rank - 1, MASTER, MPI_COMM_WORLD);
-                }
-            }
+    template<typename T, typename Compare>
+    size_t Context::scatterSort(T *begin, uint64_t totalCount, Compare compare, SortPath &path,
+                                uint64_t &descents) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
 
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
 
-            // std::cout << "I am process " << rank << " after sorting " << i << ": ";
-            // for (int i = 0; i < localCount; i++) {
-            //     std::cout << localArray[i] << " ";
-            // }
-            // std::cout << std::endl;
-        }
+        std::vector<size_t> &counts = buffers.get<size_t>(BufferPool::Counts);
+        std::vector<size_t> &displs = buffers.get<size_t>(BufferPool::Displs);
+        std::vector<T> &local = buffers.get<T>(BufferPool::Local);
+        scatterSlices(begin, totalCount, local, counts, displs);
 
-        if (rank == MASTER) {
-            for (int i = 0; i < remain; i++) {
-                *(begin + i) = localArray[i];
+        size_t phases = distributedSort(local, totalCount, compare, path, descents);
+        if (path == SortPath::Counting) {
+            // All processes have the counts, the root writes the result instead of gathering it
+            if (rank == MASTER) {
+                writeCounted(begin, 0, totalCount);
             }
-            localArray += remain;
-            localCount -= remain;
+            return phases;
         }
-        
-        MPI_Gather(localArray, localCount, MPI_LONG, begin, localCount, MPI_LONG, MASTER, MPI_COMM_WORLD);
-        
-        if (rank == MASTER) {
-            localArray -= remain;
+
+        clock.enter(Phase::Distribute);
+
+        // Collect the blocks. Element keeps the slices and radix returns the same balanced
+        // slices, the other engines may have changed their sizes.
+        if (engine != Engine::Element && engine != Engine::Radix) {
+            uint64_t count = local.size();
+            std::vector<uint64_t> &gathered = buffers.get<uint64_t>(BufferPool::Sizes);
+            gathered.resize(size);
+            MPI_Gather(&count, 1, MPI_UINT64_T, gathered.data(), 1, MPI_UINT64_T, MASTER, comm);
+            counts.assign(gathered.begin(), gathered.end());
+            for (int i = 1; i < size; i++) {
+                displs[i] = displs[i - 1] + counts[i - 1];
+            }
         }
+        gatherv(local.data(), local.size(), begin, counts, displs, type, MASTER, comm, chunk_limit, buffers);
+        return phases;
+    }
+
+    std::unique_ptr<Information> Context::mpi_sort(Element *begin, Element *end) const {
+        return mpi_sort<Element>(begin, end);
+    }
 
-        free(localArray);
-        MPI_Barrier(MPI_COMM_WORLD);
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> Context::mpi_sort_distributed(std::vector<T> &local, Compare compare) const {
+        int rank;
+        int size;
+        uint64_t localCount = local.size();
+        uint64_t totalCount;
 
-        if (rank == MASTER) {
-            information->end = high_resolution_clock::now();
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        clock.reset();
+        clock.enter(Phase::Wait);
+        MPI_Allreduce(&localCount, &totalCount, 1, MPI_UINT64_T, MPI_SUM, comm);
+        clock.enter(Phase::Compute);
+        auto information = newInformation(rank, size, totalCount, sizeof(T));
+
+        SortPath path;
+        uint64_t descents;
+        size_t phases = distributedSort(local, totalCount, compare, path, descents);
+        clock.enter(Phase::Wait);
+        MPI_Barrier(comm);
+
+        finishInformation(information.get(), phases);
+        if (information) {
+            information->path = path;
+            information->descents = descents;
         }
 
         return information;
     }
 
-    std::ostream &Context::print_information(const Information &info, std::ostream &output) {
-        auto duration = info.end - info.start;
-        auto duration_count = duration_cast<nanoseconds>(duration).count();
-        output << "Name: Li Jingyu" << std::endl; 
-        output << "Student ID: 118010141" << std::endl;
-        output << "Assignment 1, odd-even sort, MPI implementation" << std::endl;
-        output << "input size: " << info.length << std::endl;
-        output << "proc number: " << info.num_of_proc << std::endl;
-        output << "duration (ns): " << duration_count << std::endl;
-        return output;
-    }
+#define SORT_INSTANTIATE_ORDER(T, Compare) \
+    template bool Context::oddSort(T *, size_t, Compare) const; \
+    template bool Context::evenSort(T *, size_t, Compare) const; \
+    template void Context::localSort(T *, size_t, Compare) const; \
+    template size_t Context::elementSort(T *, size_t, size_t, Compare) const; \
+    template size_t Context::mergeSplit(T *, size_t, const T *, size_t, size_t, bool, bool, T *, Compare) const; \
+    template size_t Context::blockSort(T *, size_t &, size_t, Compare) const; \
+    template uint64_t Context::boundaryDescents(const T *, size_t, Compare) const; \
+    template SortPath Context::choosePath(const T *, size_t, Compare, size_t &, uint64_t &) const; \
+    template size_t Context::distributedSort(std::vector<T> &, size_t, Compare, SortPath &, uint64_t &) const; \
+    template std::unique_ptr<Information> Context::mpi_sort(T *, T *, Compare) const; \
+    template size_t Context::scatterSort(T *, uint64_t, Compare, SortPath &, uint64_t &) const; \
+    template std::unique_ptr<Information> Context::mpi_sort_distributed(std::vector<T> &, Compare) const;
+#define SORT_INSTANTIATE(T) SORT_INSTANTIATE_ORDER(T, std::less<T>) SORT_INSTANTIATE_ORDER(T, std::greater<T>) \
+    template void Context::scatterSlices(const T *, uint64_t &, std::vector<T> &, std::vector<size_t> &, \
+                                         std::vector<size_t> &) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
 }
@@ -0,0 +1,224 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <type_traits>
+
+#define MASTER 0
+
+namespace sort {
+    namespace {
+        constexpr int radixBits = 11;  // 6 passes for 64-bit keys, 3 for 32-bit keys
+        constexpr int radixSize = 1 << radixBits;
+
+        /**!
+         * Map a key to an unsigned integer with the same ascending order: flip the sign bit
+         * of signed integers, and of floats flip the sign bit of positives and every bit of negatives.
+         * Records are mapped by their key.
+         * @param value the key
+         * @return the ordered bits, in the low bits of the result
+         */
+        template<typename T>
+        uint64_t orderedBits(const T &value) {
+            if constexpr (std::is_integral_v<T>) {
+                using Bits = std::make_unsigned_t<T>;
+                Bits bits = static_cast<Bits>(value);
+                if constexpr (std::is_signed_v<T>) {
+                    bits ^= Bits{1} << (8 * sizeof(T) - 1);
+                }
+                return bits;
+            } else if constexpr (std::is_floating_point_v<T>) {
+                using Bits = std::conditional_t<sizeof(T) == 4, uint32_t, uint64_t>;
+                Bits bits = std::bit_cast<Bits>(value);
+                Bits sign = Bits{1} << (8 * sizeof(T) - 1);
+                return (bits & sign) ? static_cast<Bits>(~bits) : static_cast<Bits>(bits | sign);
+            } else {
+                return orderedBits(value.key);
+            }
+        }
+
+        /**!
+         * Number of bits in the key of an element type.
+         */
+        template<typename T>
+        constexpr int keyBits() {
+            if constexpr (std::is_arithmetic_v<T>) {
+                return 8 * sizeof(T);
+            } else {
+                return 8 * sizeof(T::key);
+            }
+        }
+
+        /**!
+         * The radix key of an element: the ordered bits, inverted for a descending order.
+         */
+        template<typename T>
+        uint64_t radixKey(const T &element, std::less<T>) {
+            return orderedBits(element);
+        }
+
+        template<typename T>
+        uint64_t radixKey(const T &element, std::greater<T>) {
+            return ~orderedBits(element);
+        }
+
+        /**!
+         * Extract a digit of the radix key of an element.
+         * @param element the element
+         * @param shift position of the lowest bit of the digit
+         * @param compare the order
+         * @return the digit
+         */
+        template<typename T, typename Compare>
+        inline int digitOf(const T &element, int shift, Compare compare) {
+            return static_cast<int>((radixKey(element, compare) >> shift) & (radixSize - 1));
+        }
+
+        /**!
+         * Stable counting sort of source into destination by one digit.
+         * @param source elements to sort
+         * @param count number of elements
+         * @param destination output, count elements
+         * @param shift position of the lowest bit of the digit
+         * @param histogram per-digit counts of the source
+         * @param offset scratch, radixSize counters
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void countingSort(const T *source, size_t count, T *destination, int shift,
+                          const std::vector<long long> &histogram, std::vector<long long> &offset, Compare compare) {
+            offset[0] = 0;
+            for (int d = 1; d < radixSize; d++) {
+                offset[d] = offset[d - 1] + histogram[d - 1];
+            }
+            for (size_t i = 0; i < count; i++) {
+                destination[offset[digitOf(source[i], shift, compare)]++] = source[i];
+            }
+        }
+
+        /**!
+         * Count the digits of the elements.
+         * @param source elements to count
+         * @param count number of elements
+         * @param shift position of the lowest bit of the digit
+         * @param histogram output, radixSize counters
+         * @param compare the order
+         */
+        template<typename T, typename Compare>
+        void countDigits(const T *source, size_t count, int shift, std::vector<long long> &histogram,
+                         Compare compare) {
+            std::fill(histogram.begin(), histogram.end(), 0);
+            for (size_t i = 0; i < count; i++) {
+                histogram[digitOf(source[i], shift, compare)]++;
+            }
+        }
+    }
+
+    template<typename T, typename Compare>
+    void Context::radixSort(T* localArray, size_t localCount, size_t totalCount, std::vector<T> &result,
+                            Compare compare) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::vector<long long> &histogram = buffers.get<long long>(BufferPool::Histogram);
+        std::vector<long long> &global = buffers.get<long long>(BufferPool::Global);
+        std::vector<long long> &before = buffers.get<long long>(BufferPool::Before);  // same digit on lower ranks
+        std::vector<long long> &offset = buffers.get<long long>(BufferPool::Offsets);
+        histogram.resize(radixSize);
+        global.resize(radixSize);
+        before.resize(radixSize);
+        offset.resize(radixSize);
+        std::vector<size_t> &sendCounts = buffers.get<size_t>(BufferPool::SendCounts);
+        std::vector<size_t> &sendDispls = buffers.get<size_t>(BufferPool::SendDispls);
+        std::vector<size_t> &recvCounts = buffers.get<size_t>(BufferPool::RecvCounts);
+        std::vector<size_t> &recvDispls = buffers.get<size_t>(BufferPool::RecvDispls);
+        sendCounts.resize(size);
+        sendDispls.assign(size, 0);
+        recvCounts.resize(size);
+        recvDispls.assign(size, 0);
+        std::vector<T> &ordered = buffers.get<T>(BufferPool::Merged);
+        ordered.resize(localCount);
+
+        result.assign(localArray, localArray + localCount);
+
+        for (int shift = 0; shift < keyBits<T>(); shift += radixBits) {
+            size_t count = result.size();
+            countDigits(result.data(), count, shift, histogram, compare);
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Allreduce(histogram.data(), global.data(), radixSize, MPI_LONG_LONG, MPI_SUM, comm);
+            }
+            if (std::find(global.begin(), global.end(), (long long) totalCount) != global.end()) {
+                continue;  // every key has the same digit, e.g. the high bits of small keys
+            }
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Exscan(histogram.data(), before.data(), radixSize, MPI_LONG_LONG, MPI_SUM, comm);
+            }
+            if (rank == MASTER) {
+                std::fill(before.begin(), before.end(), 0);
+            }
+
+            ordered.resize(count);
+            countingSort(result.data(), count, ordered.data(), shift, histogram, offset, compare);
+
+            // Elements with digit d land at global positions [start + before[d], ... + histogram[d]),
+            // where start counts the smaller digits. Rank r owns [r * total / size, (r + 1) * total / size).
+            std::fill(sendCounts.begin(), sendCounts.end(), 0);
+            long long start = 0;
+            int target = 0;
+            for (int d = 0; d < radixSize; d++) {
+                long long position = start + before[d];
+                long long last = position + histogram[d];
+                while (position < last) {
+                    long long owned = (long long) (target + 1) * totalCount / size;
+                    if (position >= owned) {
+                        target++;
+                        continue;
+                    }
+                    long long taken = std::min(last, owned) - position;
+                    sendCounts[target] += taken;
+                    position += taken;
+                }
+                start += global[d];
+            }
+            for (int i = 1; i < size; i++) {
+                sendDispls[i] = sendDispls[i - 1] + sendCounts[i - 1];
+            }
+
+            static_assert(sizeof(size_t) == sizeof(uint64_t));
+            size_t received;
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Alltoall(sendCounts.data(), 1, MPI_UINT64_T, recvCounts.data(), 1, MPI_UINT64_T, comm);
+                for (int i = 1; i < size; i++) {
+                    recvDispls[i] = recvDispls[i - 1] + recvCounts[i - 1];
+                }
+                received = recvDispls[size - 1] + recvCounts[size - 1];
+                result.resize(received);
+                alltoallv(ordered.data(), sendCounts, sendDispls, result.data(), recvCounts, recvDispls, type,
+                          comm, chunk_limit, buffers);
+            }
+
+            // The runs arrive in rank order and are each ordered by digit: a stable
+            // sort by digit yields the global order of this slice
+            countDigits(result.data(), received, shift, histogram, compare);
+            ordered.resize(received);
+            countingSort(result.data(), received, ordered.data(), shift, histogram, offset, compare);
+            result.swap(ordered);
+        }
+    }
+
+#define SORT_INSTANTIATE(T) \
+    template void Context::radixSort(T *, size_t, size_t, std::vector<T> &, std::less<T>) const; \
+    template void Context::radixSort(T *, size_t, size_t, std::vector<T> &, std::greater<T>) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
@@ -0,0 +1,112 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+
+#define MASTER 0
+
+namespace sort {
+
+    template<typename T, typename Compare>
+    void Context::sampleSort(T* localArray, size_t localCount, std::vector<T> &bucket, Compare compare) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        localSort(localArray, localCount, compare);
+
+        // Regular sampling: size evenly spaced samples from every non-empty process
+        int sampleCount = localCount > 0 ? size : 0;
+        std::vector<T> &samples = buffers.get<T>(BufferPool::Samples);
+        samples.resize(sampleCount);
+        for (int i = 0; i < sampleCount; i++) {
+            samples[i] = localArray[i * localCount / size];
+        }
+
+        std::vector<int> &sampleCounts = buffers.get<int>(BufferPool::NativeCounts);
+        std::vector<int> &sampleDispls = buffers.get<int>(BufferPool::NativeDispls);
+        std::vector<T> &allSamples = buffers.get<T>(BufferPool::AllSamples);
+        sampleCounts.resize(size);
+        sampleDispls.assign(size, 0);
+        allSamples.clear();
+        {
+            PhaseScope scope(clock, Phase::Exchange);
+            MPI_Gather(&sampleCount, 1, MPI_INT, sampleCounts.data(), 1, MPI_INT, MASTER, comm);
+            if (rank == MASTER) {
+                for (int i = 1; i < size; i++) {
+                    sampleDispls[i] = sampleDispls[i - 1] + sampleCounts[i - 1];
+                }
+                allSamples.resize(sampleDispls[size - 1] + sampleCounts[size - 1]);
+            }
+            MPI_Gatherv(samples.data(), sampleCount, type, allSamples.data(), sampleCounts.data(),
+                        sampleDispls.data(), type, MASTER, comm);
+        }
+
+        // The root picks size - 1 splitters from the sorted samples and broadcasts them
+        std::vector<T> &splitters = buffers.get<T>(BufferPool::Splitters);
+        splitters.resize(size - 1);
+        if (rank == MASTER) {
+            std::sort(allSamples.begin(), allSamples.end(), compare);
+            for (int i = 1; i < size; i++) {
+                splitters[i - 1] = allSamples.empty() ? T{} : allSamples[(long long) i * allSamples.size() / size];
+            }
+        }
+        {
+            PhaseScope scope(clock, Phase::Exchange);
+            MPI_Bcast(splitters.data(), size - 1, type, MASTER, comm);
+        }
+
+        // Bucket i takes the elements in (splitters[i - 1], splitters[i]]
+        std::vector<size_t> &sendCounts = buffers.get<size_t>(BufferPool::SendCounts);
+        std::vector<size_t> &sendDispls = buffers.get<size_t>(BufferPool::SendDispls);
+        sendCounts.resize(size);
+        sendDispls.resize(size);
+        T *position = localArray;
+        for (int i = 0; i < size; i++) {
+            T *next = i < size - 1
+                      ? std::upper_bound(position, localArray + localCount, splitters[i], compare)
+                      : localArray + localCount;
+            sendDispls[i] = position - localArray;
+            sendCounts[i] = next - position;
+            position = next;
+        }
+
+        std::vector<size_t> &recvCounts = buffers.get<size_t>(BufferPool::RecvCounts);
+        std::vector<size_t> &recvDispls = buffers.get<size_t>(BufferPool::RecvDispls);
+        recvCounts.resize(size);
+        recvDispls.assign(size, 0);
+        static_assert(sizeof(size_t) == sizeof(uint64_t));
+        {
+            PhaseScope scope(clock, Phase::Exchange);
+            MPI_Alltoall(sendCounts.data(), 1, MPI_UINT64_T, recvCounts.data(), 1, MPI_UINT64_T, comm);
+            for (int i = 1; i < size; i++) {
+                recvDispls[i] = recvDispls[i - 1] + recvCounts[i - 1];
+            }
+            bucket.resize(recvDispls[size - 1] + recvCounts[size - 1]);
+            alltoallv(localArray, sendCounts, sendDispls, bucket.data(), recvCounts, recvDispls, type, comm,
+                      chunk_limit, buffers);
+        }
+
+        // The bucket is size sorted runs, merge them pairwise
+        for (int width = 1; width < size; width *= 2) {
+            for (int i = 0; i + width < size; i += 2 * width) {
+                int last = std::min(i + 2 * width, size) - 1;
+                auto first = bucket.begin() + recvDispls[i];
+                auto middle = bucket.begin() + recvDispls[i + width];
+                auto end = bucket.begin() + recvDispls[last] + recvCounts[last];
+                std::inplace_merge(first, middle, end, compare);
+            }
+        }
+    }
+
+#define SORT_INSTANTIATE(T) \
+    template void Context::sampleSort(T *, size_t, std::vector<T> &, std::less<T>) const; \
+    template void Context::sampleSort(T *, size_t, std::vector<T> &, std::greater<T>) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
@@ -0,0 +1,161 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <thread-team.hpp>
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+
+#define MASTER 0
+
+namespace sort {
+    namespace {
+        constexpr uint64_t minSharedSegment = 1 << 16;  // elements from which a segment may be sorted by all processes
+    }
+
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> Context::mpi_sort_segments(T *data, const std::vector<uint64_t> &offsets,
+                                                            Compare compare) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        uint64_t totalCount = offsets.empty() ? 0 : offsets.back();
+        clock.reset();
+        auto information = newInformation(rank, size, totalCount, sizeof(T));
+
+        // The root splits the segments: large ones for all processes, and the small ones packed
+        // one after the other, every process taking those that start in its share of the pack
+        std::vector<uint64_t> &lengths = buffers.get<uint64_t>(BufferPool::Segments);
+        std::vector<uint64_t> &localLengths = buffers.get<uint64_t>(BufferPool::LocalSegments);
+        std::vector<T> &packed = buffers.get<T>(BufferPool::Merged);
+        std::vector<T> &local = buffers.get<T>(BufferPool::Local);
+        std::vector<size_t> &counts = buffers.get<size_t>(BufferPool::Counts);
+        std::vector<size_t> &displs = buffers.get<size_t>(BufferPool::Displs);
+        std::vector<uint64_t> &header = buffers.get<uint64_t>(BufferPool::Sizes);  // elements, segments, large
+        std::vector<size_t> &segmentCounts = buffers.get<size_t>(BufferPool::SendCounts);
+        std::vector<size_t> &segmentDispls = buffers.get<size_t>(BufferPool::SendDispls);
+        std::vector<size_t> &large = buffers.get<size_t>(BufferPool::LargeSegments);  // sorted by all processes
+        large.clear();
+        if (rank == MASTER) {
+            uint64_t share = std::max(minSharedSegment, totalCount / size);
+            uint64_t packedCount = 0;
+            lengths.clear();
+            for (size_t i = 0; i + 1 < offsets.size(); i++) {
+                uint64_t length = offsets[i + 1] - offsets[i];
+                if (length > share) {
+                    large.push_back(i);
+                } else {
+                    lengths.push_back(length);
+                    packedCount += length;
+                }
+            }
+            packed.resize(packedCount);
+            counts.assign(size, 0);
+            displs.assign(size, 0);
+            segmentCounts.assign(size, 0);
+            segmentDispls.assign(size, 0);
+            uint64_t position = 0;
+            size_t next = 0;  // index of the next small segment
+            for (size_t i = 0; i + 1 < offsets.size(); i++) {
+                if (next < large.size() && large[next] == i) {
+                    next++;
+                    continue;
+                }
+                uint64_t length = offsets[i + 1] - offsets[i];
+                int owner = static_cast<int>(position * size / std::max<uint64_t>(packedCount, 1));
+                counts[owner] += length;
+                segmentCounts[owner]++;
+                std::copy(data + offsets[i], data + offsets[i + 1], packed.begin() + position);
+                position += length;
+            }
+            for (int r = 1; r < size; r++) {
+                displs[r] = displs[r - 1] + counts[r - 1];
+                segmentDispls[r] = segmentDispls[r - 1] + segmentCounts[r - 1];
+            }
+            header.resize(3 * size);
+            for (int r = 0; r < size; r++) {
+                header[3 * r] = counts[r];
+                header[3 * r + 1] = segmentCounts[r];
+                header[3 * r + 2] = large.size();
+            }
+        }
+
+        uint64_t mine[3];
+        clock.enter(Phase::Distribute);
+        MPI_Scatter(header.data(), 3, MPI_UINT64_T, mine, 3, MPI_UINT64_T, MASTER, comm);
+        localLengths.resize(mine[1]);
+        local.resize(mine[0]);
+        scatterv(lengths.data(), segmentCounts, segmentDispls, localLengths.data(), mine[1], MPI_UINT64_T, MASTER, comm,
+                 chunk_limit, buffers);
+        scatterv(packed.data(), counts, displs, local.data(), mine[0], type, MASTER, comm, chunk_limit, buffers);
+        clock.enter(Phase::Compute);
+
+        // Every member sorts the segments that start in its part of the elements
+        auto sortSegments = [&](size_t from, size_t to) {
+            T *segment = local.data();
+            for (uint64_t length : localLengths) {
+                size_t start = segment - local.data();
+                if (start >= from && start < to) {
+                    std::sort(segment, segment + length, compare);
+                }
+                segment += length;
+            }
+        };
+        ThreadTeam *members = threadTeam(local.size());
+        if (members == nullptr) {
+            sortSegments(0, local.size());
+        } else {
+            members->run([&](int id) {
+                sortSegments(members->first(id, local.size()), members->first(id + 1, local.size()));
+            });
+        }
+
+        clock.enter(Phase::Distribute);
+        gatherv(local.data(), local.size(), packed.data(), counts, displs, type, MASTER, comm, chunk_limit, buffers);
+        clock.enter(Phase::Compute);
+        if (rank == MASTER) {
+            uint64_t position = 0;
+            size_t next = 0;
+            for (size_t i = 0; i + 1 < offsets.size(); i++) {
+                if (next < large.size() && large[next] == i) {
+                    next++;
+                    continue;
+                }
+                uint64_t length = offsets[i + 1] - offsets[i];
+                std::copy(packed.begin() + position, packed.begin() + position + length, data + offsets[i]);
+                position += length;
+            }
+        }
+
+        // The large segments, each by all processes
+        size_t phases = 0;
+        for (uint64_t i = 0; i < mine[2]; i++) {
+            SortPath path;
+            uint64_t descents;
+            if (rank == MASTER) {
+                phases += scatterSort(data + offsets[large[i]], offsets[large[i] + 1] - offsets[large[i]], compare,
+                                      path, descents);
+            } else {
+                phases += scatterSort<T>(nullptr, 0, compare, path, descents);
+            }
+            clock.enter(Phase::Compute);
+        }
+
+        clock.enter(Phase::Wait);
+        MPI_Barrier(comm);
+        finishInformation(information.get(), phases);
+        return information;
+    }
+
+#define SORT_INSTANTIATE(T) \
+    template std::unique_ptr<Information> Context::mpi_sort_segments(T *, const std::vector<uint64_t> &, \
+                                                                     std::less<T>) const; \
+    template std::unique_ptr<Information> Context::mpi_sort_segments(T *, const std::vector<uint64_t> &, \
+                                                                     std::greater<T>) const;
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
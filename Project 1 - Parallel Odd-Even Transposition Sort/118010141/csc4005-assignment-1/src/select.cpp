@@ -0,0 +1,232 @@
+#include <odd-even-sort.hpp>
+#include <mpi-type.hpp>
+#include <collectives.hpp>
+#include <mpi.h>
+#include <vector>
+#include <algorithm>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#define MASTER 0
+
+namespace sort {
+    namespace {
+        constexpr size_t samplesPerProcess = 32;  // pivot candidates from every process in a round
+        constexpr uint64_t gatherLimit = 1 << 14;  // elements left that the root selects from alone
+    }
+
+    template<typename T, typename Compare>
+    T Context::distributedSelect(std::vector<T> &local, size_t totalCount, size_t k, Compare compare,
+                                 size_t &rounds) const {
+        int rank;
+        int size;
+        MPI_Datatype type = mpi_type<T>();
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        std::vector<T> &samples = buffers.get<T>(BufferPool::Samples);
+        std::vector<std::pair<T, double>> &weighted = buffers.get<std::pair<T, double>>(BufferPool::Weighted);
+        std::vector<T> &allSamples = buffers.get<T>(BufferPool::Bucket);
+        std::vector<uint64_t> &sizes = buffers.get<uint64_t>(BufferPool::Sizes);
+        samples.resize(samplesPerProcess);
+        allSamples.resize(samplesPerProcess * size);
+        sizes.resize(2 * size);
+        std::minstd_rand random(rank + 1);
+
+        // [first, last) of the slice may still hold position k, remaining elements over all processes
+        auto first = local.begin();
+        auto last = local.end();
+        uint64_t remaining = totalCount;
+        rounds = 0;
+        while (remaining > gatherLimit) {
+            rounds++;
+            uint64_t active = last - first;
+            uint64_t mine[2] = {active, std::min<uint64_t>(active, samplesPerProcess)};
+            for (uint64_t i = 0; i < mine[1]; i++) {
+                samples[i] = first[random() % active];
+            }
+            {
+                PhaseScope scope(clock, Phase::Exchange);
+                MPI_Allgather(mine, 2, MPI_UINT64_T, sizes.data(), 2, MPI_UINT64_T, comm);
+                MPI_Allgather(samples.data(), samplesPerProcess, type, allSamples.data(), samplesPerProcess, type,
+                              comm);
+            }
+
+            // Every sample stands for active / samples elements of its process; the pivot is the
+            // sample at weight k, so both sides shrink even when the slices differ in size.
+            // All processes see the same samples and pick the same pivot.
+            weighted.clear();
+            for (int r = 0; r < size; r++) {
+                for (uint64_t i = 0; i < sizes[2 * r + 1]; i++) {
+                    weighted.emplace_back(allSamples[r * samplesPerProcess + i],
+                                          static_cast<double>(sizes[2 * r]) / sizes[2 * r + 1]);
+                }
+            }
+            std::sort(weighted.begin(), weighted.end(), [&](const auto &a, const auto &b) {
+                return compare(a.first, b.first);
+            });
+            T pivot = weighted.back().first;
+            double weight = 0;
+            for (auto &[sample, sampleWeight] : weighted) {
+                weight += sampleWeight;
+                if (weight > k) {
+                    pivot = sample;
+                    break;
+                }
+            }
+
+            // Three ways: before the pivot, equal to it, after it
+            auto lessEnd = std::partition(first, last, [&](const T &x) { return compare(x, pivot); });
+            auto equalEnd = std::partition(lessEnd, last, [&](const T &x) { return !compare(pivot, x); });
+            uint64_t parts[2] = {static_cast<uint64_t>(lessEnd - first), static_cast<uint64_t>(equalEnd - lessEnd)};
+            uint64_t global[2];
+            {
+                PhaseScope scope(clock, Phase::Wait);
+                MPI_Allreduce(parts, global, 2, MPI_UINT64_T, MPI_SUM, comm);
+            }
+            if (k < global[0]) {
+                last = lessEnd;
+                remaining = global[0];
+            } else if (k < global[0] + global[1]) {
+                return pivot;  // the pivot is in the set, so a round removes one element at least
+            } else {
+                k -= global[0] + global[1];
+                first = equalEnd;
+                remaining -= global[0] + global[1];
+            }
+        }
+
+        // Few elements left: the root selects among them
+        PhaseScope scope(clock, Phase::Distribute);
+        std::vector<size_t> &counts = buffers.get<size_t>(BufferPool::Counts);
+        std::vector<size_t> &displs = buffers.get<size_t>(BufferPool::Displs);
+        uint64_t active = last - first;
+        MPI_Gather(&active, 1, MPI_UINT64_T, sizes.data(), 1, MPI_UINT64_T, MASTER, comm);
+        counts.assign(sizes.begin(), sizes.begin() + size);
+        displs.assign(size, 0);
+        for (int i = 1; i < size; i++) {
+            displs[i] = displs[i - 1] + counts[i - 1];
+        }
+        allSamples.resize(rank == MASTER ? remaining : 0);
+        gatherv(local.data() + (first - local.begin()), active, allSamples.data(), counts, displs, type, MASTER, comm,
+                chunk_limit, buffers);
+        T selected{};
+        if (rank == MASTER) {
+            std::nth_element(allSamples.begin(), allSamples.begin() + k, allSamples.end(), compare);
+            selected = allSamples[k];
+        }
+        MPI_Bcast(&selected, 1, type, MASTER, comm);
+        return selected;
+    }
+
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> Context::mpi_select(const T *begin, const T *end, size_t k, T &selected,
+                                                     Compare compare) const {
+        int rank;
+        int size;
+        uint64_t totalCount = end - begin;
+        uint64_t position = k;
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        clock.reset();
+        auto information = newInformation(rank, size, totalCount, sizeof(T));
+        clock.enter(Phase::Wait);
+        MPI_Bcast(&position, 1, MPI_UINT64_T, MASTER, comm);
+
+        std::vector<size_t> &counts = buffers.get<size_t>(BufferPool::Counts);
+        std::vector<size_t> &displs = buffers.get<size_t>(BufferPool::Displs);
+        std::vector<T> &local = buffers.get<T>(BufferPool::Local);
+        scatterSlices(begin, totalCount, local, counts, displs);
+        if (position >= totalCount) {
+            throw std::runtime_error("mpi_select: k is not below the number of elements");
+        }
+
+        size_t rounds;
+        selected = distributedSelect(local, totalCount, position, compare, rounds);
+
+        clock.enter(Phase::Wait);
+        MPI_Barrier(comm);
+        finishInformation(information.get(), rounds);
+        return information;
+    }
+
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> Context::mpi_topk(const T *begin, const T *end, size_t k, std::vector<T> &output,
+                                                   Compare compare) const {
+        int rank;
+        int size;
+        uint64_t totalCount = end - begin;
+        uint64_t wanted = k;
+
+        MPI_Comm_rank(comm, &rank);
+        MPI_Comm_size(comm, &size);
+
+        clock.reset();
+        auto information = newInformation(rank, size, totalCount, sizeof(T));
+        clock.enter(Phase::Wait);
+        MPI_Bcast(&wanted, 1, MPI_UINT64_T, MASTER, comm);
+
+        std::vector<size_t> &counts = buffers.get<size_t>(BufferPool::Counts);
+        std::vector<size_t> &displs = buffers.get<size_t>(BufferPool::Displs);
+        std::vector<T> &local = buffers.get<T>(BufferPool::Local);
+        scatterSlices(begin, totalCount, local, counts, displs);
+        wanted = std::min(wanted, totalCount);
+        output.clear();
+
+        size_t rounds = 0;
+        if (wanted > 0) {
+            T pivot = distributedSelect(local, totalCount, wanted - 1, compare, rounds);
+
+            // Everything before the pivot goes, and of the equal ones the lower ranks' first
+            auto lessEnd = std::partition(local.begin(), local.end(), [&](const T &x) { return compare(x, pivot); });
+            auto equalEnd = std::partition(lessEnd, local.end(), [&](const T &x) { return !compare(pivot, x); });
+            uint64_t mine[2] = {static_cast<uint64_t>(lessEnd - local.begin()),
+                                static_cast<uint64_t>(equalEnd - lessEnd)};
+            std::vector<uint64_t> &sizes = buffers.get<uint64_t>(BufferPool::Sizes);
+            sizes.resize(2 * size);
+            {
+                PhaseScope scope(clock, Phase::Wait);
+                MPI_Allgather(mine, 2, MPI_UINT64_T, sizes.data(), 2, MPI_UINT64_T, comm);
+            }
+            uint64_t equalNeeded = wanted;
+            for (int r = 0; r < size; r++) {
+                equalNeeded -= sizes[2 * r];
+            }
+            for (int r = 0; r < size; r++) {
+                uint64_t taken = std::min(sizes[2 * r + 1], equalNeeded);
+                counts[r] = sizes[2 * r] + taken;
+                equalNeeded -= taken;
+            }
+            for (int i = 1; i < size; i++) {
+                displs[i] = displs[i - 1] + counts[i - 1];
+            }
+
+            clock.enter(Phase::Distribute);
+            if (rank == MASTER) {
+                output.resize(wanted);
+            }
+            gatherv(local.data(), counts[rank], output.data(), counts, displs, mpi_type<T>(), MASTER, comm,
+                    chunk_limit, buffers);
+            clock.enter(Phase::Compute);
+            std::sort(output.begin(), output.end(), compare);
+        }
+
+        clock.enter(Phase::Wait);
+        MPI_Barrier(comm);
+        finishInformation(information.get(), rounds);
+        return information;
+    }
+
+#define SORT_INSTANTIATE_ORDER(T, Compare) \
+    template T Context::distributedSelect(std::vector<T> &, size_t, size_t, Compare, size_t &) const; \
+    template std::unique_ptr<Information> Context::mpi_select(const T *, const T *, size_t, T &, Compare) const; \
+    template std::unique_ptr<Information> Context::mpi_topk(const T *, const T *, size_t, std::vector<T> &, \
+                                                            Compare) const;
+#define SORT_INSTANTIATE(T) SORT_INSTANTIATE_ORDER(T, std::less<T>) SORT_INSTANTIATE_ORDER(T, std::greater<T>)
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
@@ -0,0 +1,213 @@
+#include <shared-sort.hpp>
+#include <sort-kernels.hpp>
+#include <merge-range.hpp>
+#include <algorithm>
+#include <barrier>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+
+namespace sort {
+    using namespace std::chrono;
+
+    namespace {
+        constexpr size_t cacheLine = 64;
+
+        /** Flag
+         *  A per-thread flag on its own cache line
+         */
+        struct alignas(cacheLine) Flag {
+            bool value = false;
+        };
+
+        /**!
+         * Cut an array into partitions whose boundaries start cache lines, so no two threads
+         * write to the same line except for the pair across a boundary.
+         * @param begin the array
+         * @param count number of elements
+         * @param parts number of partitions
+         * @return parts + 1 boundaries, the first 0 and the last count
+         */
+        template<typename T>
+        std::vector<size_t> partitionBounds(const T *begin, size_t count, int parts) {
+            size_t line = std::max<size_t>(cacheLine / sizeof(T), 1);
+            auto address = reinterpret_cast<uintptr_t>(begin);
+            // first element that starts a line, if elements are aligned to themselves at all
+            size_t aligned = address % sizeof(T) == 0 ? (cacheLine - address % cacheLine) % cacheLine / sizeof(T) : 0;
+            std::vector<size_t> bounds(parts + 1);
+            for (int t = 1; t < parts; t++) {
+                size_t bound = t * count / parts;
+                if (bound > aligned) {
+                    bound = aligned + (bound - aligned) / line * line;
+                }
+                bounds[t] = std::max(bound, bounds[t - 1]);
+            }
+            bounds[parts] = count;
+            return bounds;
+        }
+    }
+
+    ThreadTeam &SharedContext::threadTeam() const {
+        int size = threads > 0 ? threads : std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+        if (!team || team->size() != size) {
+            team = std::make_unique<ThreadTeam>(size);
+        }
+        return *team;
+    }
+
+    template<typename T, typename Compare>
+    size_t SharedContext::elementSort(T *array, size_t count, const std::vector<size_t> &bounds,
+                                      Compare compare) const {
+        ThreadTeam &members = threadTeam();
+        std::vector<Flag> swapped(members.size());
+        size_t phases = 0;
+        bool done = count < 2;
+
+        // Runs on one thread between two phases, while the others wait
+        auto endPhase = [&]() noexcept {
+            phases++;
+            // A quiet odd phase followed by a quiet even phase means sorted
+            if (phases % 2 == 0) {
+                bool any = false;
+                for (auto &flag : swapped) {
+                    any |= flag.value;
+                    flag.value = false;
+                }
+                done = !any;
+            }
+            done |= phases >= count;
+        };
+        std::barrier barrier(members.size(), endPhase);
+
+        members.run([&](int id) {
+            size_t low = bounds[id];
+            size_t high = bounds[id + 1];
+            for (size_t i = 0; !done; i++) {
+                bool any = false;
+                // Pairs start at indices of the parity of the phase; a pair across the lower
+                // boundary belongs to the thread below
+                size_t start = low % 2 == i % 2 ? low : low + 1;
+                if (start < high) {
+                    any = compare_exchange(array + start, high - start, compare);
+                }
+                // The pair across the upper boundary goes last: the thread above has long
+                // left the line it shares by then, as it works from the other end
+                if (low < high && high < count && (high - 1) % 2 == i % 2 && compare(array[high], array[high - 1])) {
+                    std::swap(array[high - 1], array[high]);
+                    any = true;
+                }
+                swapped[id].value |= any;
+                barrier.arrive_and_wait();
+            }
+        });
+        return phases;
+    }
+
+    template<typename T, typename Compare>
+    size_t SharedContext::blockSort(T *array, size_t count, const std::vector<size_t> &bounds,
+                                    Compare compare) const {
+        ThreadTeam &members = threadTeam();
+        // Only the non-empty partitions merge-split. An empty one between two others would keep
+        // them from ever being compared; the members past the last partition only keep step.
+        std::vector<size_t> parts{0};
+        for (size_t t = 1; t < bounds.size(); t++) {
+            if (bounds[t] > parts.back()) {
+                parts.push_back(bounds[t]);
+            }
+        }
+        int size = static_cast<int>(parts.size()) - 1;
+        std::vector<std::vector<T>> spare(size);  // every partition flips between its place in array and this
+        std::vector<T *> current(size);  // where every partition's elements are now
+        std::vector<T *> next(size);  // where they go after this phase
+        std::vector<Flag> swapped(size);
+        size_t phases = 0;
+        bool done = size < 2 || count < 2;
+
+        auto endPhase = [&]() noexcept {
+            phases++;
+            current.swap(next);
+            next = current;
+            if (phases % 2 == 0) {
+                bool any = false;
+                for (auto &flag : swapped) {
+                    any |= flag.value;
+                    flag.value = false;
+                }
+                done = !any;
+            }
+        };
+        std::barrier barrier(members.size(), endPhase);
+
+        members.run([&](int id) {
+            if (id >= size) {
+                return;
+            }
+            T *home = array + parts[id];
+            spare[id].resize(parts[id + 1] - parts[id]);
+            current[id] = home;
+            next[id] = home;
+            std::sort(home, array + parts[id + 1], compare);
+        });
+
+        members.run([&](int id) {
+            size_t localCount = id < size ? parts[id + 1] - parts[id] : 0;
+            T *home = id < size ? array + parts[id] : nullptr;
+            for (size_t i = 0; !done; i++) {
+                int partner = static_cast<int>(i % 2) == id % 2 ? id + 1 : id - 1;
+                if (id < size && partner >= 0 && partner < size) {
+                    // Both sides merge the lower partition before the upper one, so they split the same merge
+                    int lower = std::min(id, partner);
+                    int upper = std::max(id, partner);
+                    size_t lowerCount = parts[lower + 1] - parts[lower];
+                    size_t upperCount = parts[upper + 1] - parts[upper];
+                    size_t first = id == lower ? 0 : lowerCount;
+                    T *output = current[id] == home ? spare[id].data() : home;
+                    merge_range(current[lower], lowerCount, current[upper], upperCount, first, first + localCount,
+                                output, compare);
+                    next[id] = output;
+                    swapped[id].value |= compare(current[upper][0], current[lower][lowerCount - 1]);
+                }
+                barrier.arrive_and_wait();
+            }
+
+            if (id < size && current[id] != home) {
+                std::copy(current[id], current[id] + localCount, home);
+            }
+        });
+        return phases;
+    }
+
+    template<typename T, typename Compare>
+    std::unique_ptr<Information> SharedContext::shared_sort(T *begin, T *end, Compare compare) const {
+        if (engine != Engine::Element && engine != Engine::Block) {
+            throw std::runtime_error(std::string("engine not supported by the shared-memory backend: ") +
+                                     engine_name(engine));
+        }
+        ThreadTeam &members = threadTeam();
+
+        auto information = std::make_unique<Information>();
+        information->length = end - begin;
+        information->element_size = sizeof(T);
+        information->num_of_proc = 1;
+        information->threads = members.size();
+        information->engine = engine;
+        information->start = high_resolution_clock::now();
+
+        size_t count = end - begin;
+        auto bounds = partitionBounds(begin, count, members.size());
+        information->phases = engine == Engine::Element
+                              ? elementSort(begin, count, bounds, compare)
+                              : blockSort(begin, count, bounds, compare);
+
+        information->end = high_resolution_clock::now();
+        return information;
+    }
+
+#define SORT_INSTANTIATE_ORDER(T, Compare) \
+    template size_t SharedContext::elementSort(T *, size_t, const std::vector<size_t> &, Compare) const; \
+    template size_t SharedContext::blockSort(T *, size_t, const std::vector<size_t> &, Compare) const; \
+    template std::unique_ptr<Information> SharedContext::shared_sort(T *, T *, Compare) const;
+#define SORT_INSTANTIATE(T) SORT_INSTANTIATE_ORDER(T, std::less<T>) SORT_INSTANTIATE_ORDER(T, std::greater<T>)
+
+    SORT_FOR_EACH_TYPE(SORT_INSTANTIATE)
+}
@@ -0,0 +1,139 @@
+#include <sort-io.hpp>
+#include <text-io.hpp>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace sort {
+    namespace {
+        std::runtime_error ioError(const std::string &what, const char *path) {
+            return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    const char *format_name(Format format) {
+        switch (format) {
+            case Format::Text:
+                return "text";
+            case Format::Binary:
+                return "binary";
+        }
+        return "unknown";
+    }
+
+    bool parse_format(const char *name, Format &format) {
+        for (auto candidate : {Format::Text, Format::Binary}) {
+            if (std::strcmp(name, format_name(candidate)) == 0) {
+                format = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    MappedArray::MappedArray(MappedArray &&other) noexcept
+            : data(std::exchange(other.data, nullptr)), length(std::exchange(other.length, 0)) {}
+
+    MappedArray &MappedArray::operator=(MappedArray &&other) noexcept {
+        std::swap(data, other.data);
+        std::swap(length, other.length);
+        return *this;
+    }
+
+    MappedArray::~MappedArray() {
+        if (data != nullptr) {
+            munmap(data, length * sizeof(Element));
+        }
+    }
+
+    MappedArray MappedArray::open(const char *path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            throw ioError("failed to open", path);
+        }
+        struct stat status{};
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            throw ioError("failed to stat", path);
+        }
+        if (status.st_size % sizeof(Element) != 0) {
+            ::close(fd);
+            throw std::runtime_error(std::string("binary input is not a whole number of elements: ") + path);
+        }
+
+        MappedArray array;
+        array.length = status.st_size / sizeof(Element);
+        if (array.length > 0) {
+            void *address = mmap(nullptr, status.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                throw ioError("failed to map", path);
+            }
+            madvise(address, status.st_size, MADV_SEQUENTIAL);
+            array.data = static_cast<Element *>(address);
+            to_little_endian(array.begin(), array.end());
+        }
+        ::close(fd);
+        return array;
+    }
+
+    MappedArray MappedArray::create(const char *path, size_t length) {
+        int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw ioError("failed to create", path);
+        }
+        size_t bytes = length * sizeof(Element);
+        if (ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            throw ioError("failed to resize", path);
+        }
+
+        MappedArray array;
+        array.length = length;
+        if (length > 0) {
+            void *address = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (address == MAP_FAILED) {
+                ::close(fd);
+                throw ioError("failed to map", path);
+            }
+            array.data = static_cast<Element *>(address);
+        }
+        ::close(fd);
+        return array;
+    }
+
+    std::vector<Element> read_text(const char *path) {
+        constexpr size_t block = size_t{1} << 16;
+        std::vector<Element> data;
+        TextReader reader(path);
+        size_t count = 0;
+        while (true) {
+            data.resize(count + block);
+            size_t parsed = reader.read(data.data() + count, block);
+            count += parsed;
+            if (parsed < block) {
+                break;
+            }
+        }
+        data.resize(count);
+        return data;
+    }
+
+    void write_text(const char *path, const Element *begin, const Element *end) {
+        TextWriter writer(path);
+        writer.write(begin, end);
+        writer.close();
+    }
+
+    void write_binary(const char *path, const Element *begin, const Element *end) {
+        auto output = MappedArray::create(path, end - begin);
+        std::copy(begin, end, output.begin());
+        to_little_endian(output.begin(), output.end());
+    }
+}
@@ -0,0 +1,127 @@
+#include <sort-kernels.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SORT_KERNELS_X86 1
+#endif
+
+namespace sort {
+    namespace {
+        bool compareExchangeScalar(Element *array, size_t count) {
+            bool swapped = false;
+            for (size_t j = 0; j + 1 < count; j += 2) {
+                Element first = array[j];
+                Element second = array[j + 1];
+                swapped |= first > second;
+                array[j] = first < second ? first : second;
+                array[j + 1] = first < second ? second : first;
+            }
+            return swapped;
+        }
+
+#ifdef SORT_KERNELS_X86
+        __attribute__((target("avx2")))
+        bool compareExchangeAVX2(Element *array, size_t count) {
+            __m256i swapped = _mm256_setzero_si256();
+            size_t j = 0;
+            for (; j + 8 <= count; j += 8) {
+                // [a0 b0 a1 b1] against [b0 a0 b1 a1]: where greater, take the other
+                __m256i x = _mm256_loadu_si256(reinterpret_cast<__m256i *>(array + j));
+                __m256i y = _mm256_loadu_si256(reinterpret_cast<__m256i *>(array + j + 4));
+                __m256i xs = _mm256_shuffle_epi32(x, 0x4E);
+                __m256i ys = _mm256_shuffle_epi32(y, 0x4E);
+                __m256i xgt = _mm256_cmpgt_epi64(x, xs);
+                __m256i ygt = _mm256_cmpgt_epi64(y, ys);
+                __m256i xmin = _mm256_blendv_epi8(x, xs, xgt);
+                __m256i xmax = _mm256_blendv_epi8(xs, x, xgt);
+                __m256i ymin = _mm256_blendv_epi8(y, ys, ygt);
+                __m256i ymax = _mm256_blendv_epi8(ys, y, ygt);
+                // The first of every pair gets the minimum, the second the maximum
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(array + j), _mm256_blend_epi32(xmin, xmax, 0xCC));
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(array + j + 4), _mm256_blend_epi32(ymin, ymax, 0xCC));
+                swapped = _mm256_or_si256(swapped, _mm256_or_si256(xgt, ygt));
+            }
+            // Only the first lane of a pair says "first > second"
+            bool any = (_mm256_movemask_pd(_mm256_castsi256_pd(swapped)) & 0x5) != 0;
+            return compareExchangeScalar(array + j, count - j) || any;
+        }
+
+        __attribute__((target("avx512f")))
+        bool compareExchangeAVX512(Element *array, size_t count) {
+            __mmask8 swapped = 0;
+            size_t j = 0;
+            for (; j + 16 <= count; j += 16) {
+                __m512i x = _mm512_loadu_si512(array + j);
+                __m512i y = _mm512_loadu_si512(array + j + 8);
+                __m512i xs = _mm512_shuffle_epi32(x, _MM_PERM_BADC);
+                __m512i ys = _mm512_shuffle_epi32(y, _MM_PERM_BADC);
+                swapped |= _mm512_cmpgt_epi64_mask(x, xs) | _mm512_cmpgt_epi64_mask(y, ys);
+                // The first of every pair gets the minimum, the second the maximum
+                _mm512_storeu_si512(array + j, _mm512_mask_blend_epi64(0xAA, _mm512_min_epi64(x, xs),
+                                                                       _mm512_max_epi64(x, xs)));
+                _mm512_storeu_si512(array + j + 8, _mm512_mask_blend_epi64(0xAA, _mm512_min_epi64(y, ys),
+                                                                           _mm512_max_epi64(y, ys)));
+            }
+            // Only the first lane of a pair says "first > second"
+            bool any = (swapped & 0x55) != 0;
+            return compareExchangeScalar(array + j, count - j) || any;
+        }
+#endif
+    }
+
+    const char *kernel_name(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::Scalar:
+                return "scalar";
+            case Kernel::AVX2:
+                return "avx2";
+            case Kernel::AVX512:
+                return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool kernel_supported(Kernel kernel) {
+        switch (kernel) {
+            case Kernel::Scalar:
+                return true;
+#ifdef SORT_KERNELS_X86
+            case Kernel::AVX2:
+                return __builtin_cpu_supports("avx2");
+            case Kernel::AVX512:
+                return __builtin_cpu_supports("avx512f");
+#endif
+            default:
+                return false;
+        }
+    }
+
+    Kernel best_kernel() {
+        static const Kernel best = [] {
+            for (auto kernel : {Kernel::AVX512, Kernel::AVX2}) {
+                if (kernel_supported(kernel)) {
+                    return kernel;
+                }
+            }
+            return Kernel::Scalar;
+        }();
+        return best;
+    }
+
+    bool compare_exchange(Kernel kernel, Element *array, size_t count) {
+        switch (kernel) {
+#ifdef SORT_KERNELS_X86
+            case Kernel::AVX2:
+                return compareExchangeAVX2(array, count);
+            case Kernel::AVX512:
+                return compareExchangeAVX512(array, count);
+#endif
+            default:
+                return compareExchangeScalar(array, count);
+        }
+    }
+
+    bool compare_exchange(Element *array, size_t count) {
+        return compare_exchange(best_kernel(), array, count);
+    }
+}
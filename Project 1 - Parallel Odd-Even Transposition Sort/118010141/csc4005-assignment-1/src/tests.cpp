@@ -1,11 +1,34 @@
 #include <gtest/gtest.h>
 #include <odd-even-sort.hpp>
+#include <sort-kernels.hpp>
+#include <shared-sort.hpp>
+#include <external-sort.hpp>
+#include <batch-sort.hpp>
+#include <record-sort.hpp>
+#include <collectives.hpp>
+#include <mpi-io.hpp>
+#include <text-io.hpp>
+#include <array>
+#include <bit>
+#include <filesystem>
+#include <iomanip>
+#include <fstream>
+#include <limits>
 #include <random>
+#include <sstream>
 #include <mpi.h>
 
 using namespace sort;
 std::unique_ptr<Context> context;
-TEST(OddEvenSort, Basic) {
+
+class OddEvenSort : public ::testing::TestWithParam<Engine> {
+protected:
+    void SetUp() override {
+        context->engine = GetParam();
+    }
+};
+
+TEST_P(OddEvenSort, Basic) {
 
     int rank;
     uint64_t cases;
@@ -36,7 +59,7 @@ TEST(OddEvenSort, Basic) {
     }
 }
 
-TEST(OddEvenSort, Random) {
+TEST_P(OddEvenSort, Random) {
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     if (rank == 0) {
@@ -58,6 +81,765 @@ TEST(OddEvenSort, Random) {
     }
 }
 
+TEST_P(OddEvenSort, EarlyExit) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    context->adaptive = false;  // the engine itself must stop early
+    if (rank == 0) {
+        std::vector<Element> data(4096);
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<Element>(i / 2);
+        }
+        std::swap(data[100], data[101]);
+        std::vector<Element> a = data;
+        std::vector<Element> b = data;
+        auto info = context->mpi_sort(a.data(), a.data() + a.size());
+        std::sort(b.data(), b.data() + b.size());
+        EXPECT_EQ(a, b);
+        EXPECT_LT(info->phases, data.size());
+    } else {
+        context->mpi_sort(nullptr, nullptr);
+    }
+    context->adaptive = true;
+}
+
+TEST_P(OddEvenSort, Presorted) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    size_t count = 6000;
+    std::vector<Element> sorted(count);
+    std::vector<Element> appended(count);  // three sorted logs, one after the other
+    std::vector<Element> nearly(count);  // every 100th key a few places off
+    std::vector<Element> random(count);
+    auto gen = std::default_random_engine(4005);
+    for (size_t i = 0; i < count; ++i) {
+        sorted[i] = static_cast<Element>(i);
+        appended[i] = static_cast<Element>(i % (count / 3) * 3 + i / (count / 3));
+        nearly[i] = static_cast<Element>(i) + (i % 100 == 0 ? 5 : 0);
+        random[i] = static_cast<Element>(gen() % 1000);
+    }
+    std::vector<std::pair<std::vector<Element>, std::vector<SortPath>>> cases{
+            {sorted, {SortPath::Presorted}},
+            {appended, {SortPath::Adaptive, SortPath::AdaptiveEngine}},
+            {nearly, {SortPath::Adaptive, SortPath::AdaptiveEngine}},
+            {random, {SortPath::Engine}},
+    };
+    for (auto &[data, paths] : cases) {
+        if (rank == 0) {
+            std::vector<Element> expected = data;
+            std::sort(expected.begin(), expected.end());
+            auto info = context->mpi_sort(data.data(), data.data() + data.size());
+            EXPECT_EQ(data, expected);
+            EXPECT_NE(std::find(paths.begin(), paths.end(), info->path), paths.end()) << sort_path_name(info->path);
+            if (info->path == SortPath::Presorted) {
+                EXPECT_EQ(info->descents, 0u);
+            }
+        } else {
+            context->mpi_sort(nullptr, nullptr);
+        }
+    }
+}
+
+TEST_P(OddEvenSort, Distributed) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    // Uneven slices, every third process empty
+    std::vector<Element> local(rank % 3 == 1 ? 0 : 100 + 37 * rank);
+    auto gen = std::default_random_engine(rank);
+    auto dist = std::uniform_int_distribution<Element>{-1000, 1000};
+    for (auto &i : local) {
+        i = dist(gen);
+    }
+
+    int localCount = static_cast<int>(local.size());
+    std::vector<int> counts(size);
+    std::vector<int> displs(size);
+    MPI_Gather(&localCount, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int i = 1; i < size; ++i) {
+        displs[i] = displs[i - 1] + counts[i - 1];
+    }
+    std::vector<Element> b(displs[size - 1] + counts[size - 1]);
+    MPI_Gatherv(local.data(), localCount, MPI_INT64_T, b.data(), counts.data(), displs.data(), MPI_INT64_T,
+                0, MPI_COMM_WORLD);
+
+    context->mpi_sort_distributed(local);
+
+    localCount = static_cast<int>(local.size());
+    MPI_Gather(&localCount, 1, MPI_INT, counts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+    for (int i = 1; i < size; ++i) {
+        displs[i] = displs[i - 1] + counts[i - 1];
+    }
+    std::vector<Element> a(displs[size - 1] + counts[size - 1]);
+    MPI_Gatherv(local.data(), localCount, MPI_INT64_T, a.data(), counts.data(), displs.data(), MPI_INT64_T,
+                0, MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::sort(b.begin(), b.end());
+        EXPECT_EQ(a, b);
+    }
+}
+
+/**!
+ * Sort data from the root in the given order and compare with std::sort.
+ * The other processes only join with null pointers.
+ */
+template<typename T, typename Compare = std::less<T>>
+void expectSorted(int rank, std::vector<T> data, Compare compare = Compare()) {
+    if (rank == 0) {
+        std::vector<T> expected = data;
+        std::sort(expected.begin(), expected.end(), compare);
+        auto info = context->mpi_sort(data.data(), data.data() + data.size(), compare);
+        EXPECT_EQ(data, expected);
+        EXPECT_EQ(info->element_size, sizeof(T));
+    } else {
+        context->mpi_sort<T>(nullptr, nullptr, compare);
+    }
+}
+
+TEST_P(OddEvenSort, Types) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // The same keys on all processes, only the root's are used
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<int32_t>{-500, 500};
+    std::vector<int32_t> keys(1000);
+    for (auto &i : keys) {
+        i = dist(gen);
+    }
+
+    expectSorted(rank, keys);
+    expectSorted(rank, keys, std::greater<int32_t>());
+    expectSorted(rank, std::vector<uint32_t>(keys.begin(), keys.end()));
+    expectSorted(rank, std::vector<uint64_t>(keys.begin(), keys.end()), std::greater<uint64_t>());
+    std::vector<float> floats(keys.size());
+    std::vector<double> doubles(keys.size());
+    std::vector<KeyValue32> records32(keys.size());
+    std::vector<KeyValue64> records64(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        floats[i] = static_cast<float>(keys[i]) / 8;
+        doubles[i] = -static_cast<double>(keys[i]) / 3;
+        // The value follows from the key, so the order of equal keys does not matter
+        records32[i] = {keys[i], keys[i] * 7};
+        records64[i] = {static_cast<int64_t>(keys[i]) << 32, keys[i]};
+    }
+    expectSorted(rank, floats);
+    expectSorted(rank, doubles, std::greater<double>());
+    expectSorted(rank, records32);
+    expectSorted(rank, records64, std::greater<KeyValue64>());
+}
+
+TEST_P(OddEvenSort, Chunked) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    // Every transfer is larger than the limit, so all of them take the chunked path,
+    // with a last chunk that is not full
+    context->chunk_limit = 7;
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-100, 100};
+    std::vector<Element> data(1001);
+    for (auto &i : data) {
+        i = dist(gen);
+    }
+    expectSorted(rank, data);
+    expectSorted(rank, std::vector<int32_t>(data.begin(), data.end()), std::greater<int32_t>());
+    context->chunk_limit = INT_MAX;
+}
+
+TEST_P(OddEvenSort, Threads) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Enough elements for a team of 3 on every process. Reversed runs of 50 keep the
+    // element engine to a few phases.
+    context->threads = 3;
+    std::vector<Element> data(3 * (1 << 14) * size + 17);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<Element>(i / 50 * 50 + 49 - i % 50);
+    }
+    std::vector<double> negated(data.size());
+    for (size_t i = 0; i < data.size(); ++i) {
+        negated[i] = -static_cast<double>(data[i]);
+    }
+    expectSorted(rank, data);
+    expectSorted(rank, negated, std::greater<double>());
+    context->threads = 1;
+}
+
+TEST_P(OddEvenSort, Records) {
+    struct Record {
+        int32_t id;
+        double key;
+        char payload[40];
+    };
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        auto gen = std::default_random_engine(4005);
+        auto dist = std::uniform_int_distribution<int>{-200, 200};
+        std::vector<Record> records(1500);
+        std::vector<uint64_t> keys(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            records[i].id = static_cast<int32_t>(i);
+            records[i].key = dist(gen) / 8.0;
+            std::snprintf(records[i].payload, sizeof(records[i].payload), "record %zu", i);
+            keys[i] = static_cast<uint64_t>(dist(gen)) * 0x9e3779b97f4a7c15ULL;  // the whole unsigned range
+        }
+        std::vector<Record> original = records;
+        mpi_sort_records(*context, records.data(), records.data() + records.size(), &Record::key,
+                         std::greater<double>());
+        for (size_t i = 0; i < records.size(); ++i) {
+            const Record &record = records[i];
+            EXPECT_EQ(std::string(record.payload), std::string(original[record.id].payload));
+            EXPECT_EQ(record.key, original[record.id].key);
+            if (i > 0) {
+                EXPECT_GE(records[i - 1].key, record.key);
+            }
+        }
+
+        std::vector<uint64_t> permutation;
+        mpi_argsort(*context, keys.data(), keys.data() + keys.size(), permutation);
+        std::vector<uint64_t> sorted(keys.size());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            sorted[i] = keys[permutation[i]];
+        }
+        EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+        std::sort(permutation.begin(), permutation.end());
+        for (size_t i = 0; i < permutation.size(); ++i) {
+            EXPECT_EQ(permutation[i], i);
+        }
+    } else {
+        mpi_sort_records<Record>(*context, nullptr, nullptr, &Record::key, std::greater<double>());
+        std::vector<uint64_t> permutation;
+        mpi_argsort<uint64_t>(*context, nullptr, nullptr, permutation);
+    }
+}
+
+TEST_P(OddEvenSort, PhaseTimes) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::vector<Element> data(1000);
+    for (size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<Element>(data.size() - i);
+    }
+    auto info = context->mpi_sort(rank == 0 ? data.data() : nullptr, rank == 0 ? data.data() + data.size() : nullptr);
+    if (rank == 0) {
+        EXPECT_TRUE(std::is_sorted(data.begin(), data.end()));
+        if (SORT_INSTRUMENT) {
+            ASSERT_EQ(info->ranks.size(), static_cast<size_t>(size));
+            for (auto &times : info->ranks) {
+                for (auto ns : times) {
+                    EXPECT_GE(ns, 0);
+                }
+            }
+            EXPECT_GT(info->ranks[0][static_cast<size_t>(Phase::Compute)], 0);
+        } else {
+            EXPECT_TRUE(info->ranks.empty());
+        }
+    }
+}
+
+TEST_P(OddEvenSort, Reuse) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<Element> input(2000);
+    auto gen = std::default_random_engine(4005);
+    std::uniform_int_distribution<Element> dist(0, 1000000);
+    for (auto &x : input) {
+        x = dist(gen);
+    }
+    auto sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Once warm (sample sort trades the slice and bucket vectors, so two sorts), sorts of
+    // the same size need no more buffers and no more requests
+    size_t bytes = 0;
+    size_t requests = 0;
+    for (int round = 0; round < 4; round++) {
+        auto data = input;
+        if (rank == 0) {
+            context->mpi_sort(data.data(), data.data() + data.size());
+            EXPECT_EQ(data, sorted);
+        } else {
+            context->mpi_sort(nullptr, nullptr);
+        }
+        if (round > 1) {
+            EXPECT_EQ(context->buffers.bytes(), bytes);
+            EXPECT_EQ(context->persistentRequests().size(), requests);
+        }
+        bytes = context->buffers.bytes();
+        requests = context->persistentRequests().size();
+    }
+    EXPECT_GT(bytes, 0u);
+}
+
+TEST_P(OddEvenSort, UnevenRequests) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::vector<Element> input(2001);
+    auto gen = std::default_random_engine(4005);
+    std::uniform_int_distribution<Element> dist(0, 1000000);
+    for (auto &x : input) {
+        x = dist(gen);
+    }
+    auto sorted = input;
+    std::sort(sorted.begin(), sorted.end());
+
+    // Block lengths change from phase to phase when the count does not divide evenly, yet
+    // every partner keeps one receive and at most one send
+    context->persistentRequests().clear();
+    auto cube = static_cast<unsigned>(size);
+    bool hypercube = GetParam() == Engine::Bitonic && std::has_single_bit(cube);
+    size_t partners = hypercube ? std::max(2, std::countr_zero(cube)) : 2;
+    for (int round = 0; round < 2; round++) {
+        auto data = input;
+        if (rank == 0) {
+            context->mpi_sort(data.data(), data.data() + data.size());
+            EXPECT_EQ(data, sorted);
+        } else {
+            context->mpi_sort(nullptr, nullptr);
+        }
+        EXPECT_LE(context->persistentRequests().size(), 2 * partners);
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Engines, OddEvenSort,
+                         ::testing::Values(Engine::Element, Engine::Block, Engine::Sample, Engine::Radix, Engine::Bitonic),
+                         [](const ::testing::TestParamInfo<Engine> &info) {
+                             return std::string(engine_name(info.param));
+                         });
+
+TEST(Bitonic, Stages) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    std::vector<Element> data(3001);
+    auto gen = std::default_random_engine(4005);
+    for (auto &x : data) {
+        x = static_cast<Element>(gen() % 1000);
+    }
+    auto expected = data;
+    std::sort(expected.begin(), expected.end(), std::greater<>());
+
+    context->engine = Engine::Bitonic;
+    auto info = context->mpi_sort(rank == 0 ? data.data() : nullptr, rank == 0 ? data.data() + data.size() : nullptr,
+                                  std::greater<Element>());
+    context->engine = Engine::Block;
+    if (rank == 0) {
+        EXPECT_EQ(data, expected);
+        if (std::has_single_bit(static_cast<unsigned>(size))) {
+            size_t dimensions = std::countr_zero(static_cast<unsigned>(size));
+            EXPECT_EQ(info->engine, Engine::Bitonic);
+            EXPECT_EQ(info->phases, dimensions * (dimensions + 1) / 2);
+        } else {
+            EXPECT_EQ(info->engine, Engine::Block);  // the fallback
+        }
+    }
+}
+
+TEST(Segments, SortEach) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    // Many small segments, some empty, and one long enough to be sorted by all processes
+    auto gen = std::default_random_engine(4005);
+    std::vector<uint64_t> offsets{0};
+    for (int i = 0; i < 2000; ++i) {
+        offsets.push_back(offsets.back() + (i == 700 ? 300000 : gen() % 300));
+    }
+    std::vector<double> data(offsets.back());
+    for (auto &x : data) {
+        x = static_cast<double>(gen() % 10000) / 7;
+    }
+    auto expected = data;
+    for (size_t i = 0; i + 1 < offsets.size(); ++i) {
+        std::sort(expected.begin() + offsets[i], expected.begin() + offsets[i + 1], std::greater<>());
+    }
+
+    if (rank == 0) {
+        auto info = context->mpi_sort_segments(data.data(), offsets, std::greater<double>());
+        EXPECT_EQ(data, expected);
+        EXPECT_EQ(info->length, data.size());
+    } else {
+        context->mpi_sort_segments<double>(nullptr, {}, std::greater<double>());
+    }
+
+    // No segments at all
+    std::vector<uint64_t> none;
+    context->mpi_sort_segments<double>(nullptr, rank == 0 ? std::vector<uint64_t>{0} : none);
+}
+
+TEST(Select, MatchNthElement) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    std::vector<Element> data(50000);  // enough for a few rounds before the root takes over
+    auto gen = std::default_random_engine(4005);
+    for (auto &x : data) {
+        x = static_cast<Element>(gen() % 5000);
+    }
+    const Element *begin = rank == 0 ? data.data() : nullptr;
+    const Element *end = rank == 0 ? data.data() + data.size() : nullptr;
+
+    for (size_t k : {size_t{0}, size_t{1}, data.size() / 2, data.size() - 1}) {
+        auto expected = data;
+        std::nth_element(expected.begin(), expected.begin() + k, expected.end(), std::greater<>());
+        Element selected;
+        auto info = context->mpi_select(begin, end, k, selected, std::greater<Element>());
+        EXPECT_EQ(selected, expected[k]) << k;
+        if (rank == 0) {
+            EXPECT_GT(info->phases, 0u);
+        }
+    }
+    Element unused;
+    EXPECT_THROW(context->mpi_select(begin, end, data.size(), unused), std::runtime_error);
+
+    for (size_t k : {size_t{0}, size_t{100}, data.size() + 5}) {
+        auto expected = data;
+        std::sort(expected.begin(), expected.end());
+        expected.resize(std::min(k, data.size()));
+        std::vector<Element> top;
+        context->mpi_topk(begin, end, k, top);
+        if (rank == 0) {
+            EXPECT_EQ(top, expected) << k;
+        } else {
+            EXPECT_TRUE(top.empty());
+        }
+    }
+}
+
+TEST(DistinctKeys, Counting) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    size_t count = 200'000;
+    auto gen = std::default_random_engine(4005);
+    std::vector<int64_t> few(count);  // 300 keys
+    std::vector<int64_t> hidden(count);  // 300 frequent keys and 5000 rare ones the samples mostly miss
+    std::vector<int64_t> many(count);
+    for (size_t i = 0; i < count; ++i) {
+        few[i] = static_cast<int64_t>(gen() % 300) * 1'000'003 - 150'000'000;
+        hidden[i] = i % 40 == 0 ? static_cast<int64_t>(i) << 20 : few[i];
+        many[i] = static_cast<int64_t>(gen());
+    }
+    std::vector<std::pair<std::vector<int64_t>, SortPath>> cases{
+            {few, SortPath::Counting},
+            {hidden, SortPath::Engine},
+            {many, SortPath::Engine},
+    };
+    for (auto &[input, path] : cases) {
+        for (bool descending : {false, true}) {
+            if (rank == 0) {
+                std::vector<int64_t> data = input;
+                std::vector<int64_t> expected = input;
+                std::unique_ptr<Information> info;
+                if (descending) {
+                    std::sort(expected.begin(), expected.end(), std::greater<int64_t>());
+                    info = context->mpi_sort(data.data(), data.data() + data.size(), std::greater<int64_t>());
+                } else {
+                    std::sort(expected.begin(), expected.end());
+                    info = context->mpi_sort(data.data(), data.data() + data.size());
+                }
+                EXPECT_EQ(data, expected);
+                EXPECT_EQ(info->path, path) << sort_path_name(info->path);
+            } else if (descending) {
+                context->mpi_sort<int64_t>(nullptr, nullptr, std::greater<int64_t>());
+            } else {
+                context->mpi_sort(nullptr, nullptr);
+            }
+        }
+    }
+
+    // Equal keys of records are not identical, they always go to the engine
+    std::vector<KeyValue32> records(count);
+    for (size_t i = 0; i < count; ++i) {
+        records[i] = {static_cast<int32_t>(few[i] % 1000), static_cast<int32_t>(i)};
+    }
+    if (rank == 0) {
+        auto info = context->mpi_sort(records.data(), records.data() + records.size());
+        EXPECT_TRUE(std::is_sorted(records.begin(), records.end()));
+        EXPECT_NE(info->path, SortPath::Counting);
+    } else {
+        context->mpi_sort<KeyValue32>(nullptr, nullptr);
+    }
+}
+
+TEST(Kernels, MatchScalar) {
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-3, 3};
+    for (int count = 0; count < 67; ++count) {
+        std::vector<Element> data(count);
+        for (auto &i : data) {
+            i = dist(gen);
+        }
+        std::vector<Element> expected = data;
+        bool expectedSwapped = compare_exchange(Kernel::Scalar, expected.data(), count);
+        for (auto kernel : {Kernel::AVX2, Kernel::AVX512}) {
+            if (!kernel_supported(kernel)) {
+                continue;
+            }
+            std::vector<Element> a = data;
+            EXPECT_EQ(compare_exchange(kernel, a.data(), count), expectedSwapped) << kernel_name(kernel);
+            EXPECT_EQ(a, expected) << kernel_name(kernel);
+        }
+    }
+}
+
+TEST(SharedSort, Engines) {
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-1000, 1000};
+    SharedContext shared;
+    for (auto engine : {Engine::Element, Engine::Block}) {
+        shared.engine = engine;
+        for (int threads : {1, 3, 4}) {
+            shared.threads = threads;
+            // Down to fewer elements than threads or cache lines, starting off a cache line
+            for (size_t count : {0, 1, 2, 5, 37, 1000}) {
+                std::vector<Element> data(count + 1);
+                for (auto &i : data) {
+                    i = dist(gen);
+                }
+                std::vector<Element> expected(data.begin() + 1, data.end());
+                std::sort(expected.begin(), expected.end());
+                auto info = shared.shared_sort(data.data() + 1, data.data() + data.size());
+                EXPECT_TRUE(std::equal(expected.begin(), expected.end(), data.begin() + 1))
+                    << engine_name(engine) << " " << threads << " " << count;
+                EXPECT_EQ(info->threads, threads);
+            }
+            std::vector<float> floats(777);
+            for (auto &i : floats) {
+                i = static_cast<float>(dist(gen)) / 4;
+            }
+            std::vector<float> expected = floats;
+            std::sort(expected.begin(), expected.end(), std::greater<float>());
+            shared.shared_sort(floats.data(), floats.data() + floats.size(), std::greater<float>());
+            EXPECT_EQ(floats, expected) << engine_name(engine) << " " << threads;
+        }
+    }
+}
+
+TEST(SharedSort, AlignedSmall) {
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-1000, 1000};
+    SharedContext shared;
+    // Starting on a cache line, several threads round their bounds down to the same line
+    alignas(64) std::array<Element, 64> data{};
+    for (auto engine : {Engine::Element, Engine::Block}) {
+        shared.engine = engine;
+        for (int threads : {4, 8}) {
+            shared.threads = threads;
+            for (size_t count = 0; count <= data.size(); count++) {
+                for (size_t i = 0; i < count; i++) {
+                    data[i] = dist(gen);
+                }
+                std::vector<Element> expected(data.begin(), data.begin() + count);
+                std::sort(expected.begin(), expected.end());
+                shared.shared_sort(data.data(), data.data() + count);
+                EXPECT_TRUE(std::equal(expected.begin(), expected.end(), data.begin()))
+                    << engine_name(engine) << " " << threads << " " << count;
+            }
+        }
+    }
+}
+
+TEST(Information, StreamFormat) {
+    Information info;
+    info.ranks.assign(2, PhaseTimes{3, 1, 4, 1});
+    std::ostringstream output;
+    output << std::scientific << std::setprecision(5);
+    Context::print_information(info, output);
+    EXPECT_NE(output.str().find("imbalance"), std::string::npos);
+    EXPECT_EQ(output.precision(), 5);
+    EXPECT_EQ(output.flags() & std::ios::floatfield, std::ios::scientific);
+}
+
+TEST(MpiIO, BinaryRoundTrip) {
+    int rank;
+    int size;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    auto directory = std::filesystem::temp_directory_path();
+    std::string input = (directory / "mpi-io-input.bin").string();
+    std::string output = (directory / "mpi-io-output.bin").string();
+
+    // A prime count, so that the slices differ in length at every process count
+    std::vector<Element> data(10'007);
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-100'000, 100'000};
+    for (auto &i : data) {
+        i = dist(gen);
+    }
+    if (rank == 0) {
+        write_binary(input.c_str(), data.data(), data.data() + data.size());
+    }
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    auto local = mpi_read_binary(input.c_str());
+    size_t first = rank * data.size() / size;
+    size_t last = (rank + 1) * data.size() / size;
+    EXPECT_EQ(local, std::vector<Element>(data.begin() + first, data.begin() + last));
+
+    context->mpi_sort_distributed(local);
+    mpi_write_binary(output.c_str(), local);
+    MPI_Barrier(MPI_COMM_WORLD);
+    if (rank == 0) {
+        std::sort(data.begin(), data.end());
+        auto sorted = MappedArray::open(output.c_str());
+        EXPECT_EQ(std::vector<Element>(sorted.begin(), sorted.end()), data);
+        std::filesystem::remove(input);
+        std::filesystem::remove(output);
+    }
+}
+
+TEST(TextIO, RoundTrip) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank != 0) {
+        return;
+    }
+    auto directory = std::filesystem::temp_directory_path();
+    std::string input = (directory / "text-io-input.txt").string();
+    std::string output = (directory / "text-io-output.txt").string();
+
+    // More than one 4 MiB chunk, tabs, CRLF and runs of separators, plus signs, nothing after the last number
+    std::vector<Element> data(500'000);
+    auto gen = std::default_random_engine(4005);
+    auto dist = std::uniform_int_distribution<Element>{-1'000'000'000, 1'000'000'000};
+    for (auto &i : data) {
+        i = dist(gen);
+    }
+    data[1] = std::numeric_limits<Element>::min();
+    data[2] = std::numeric_limits<Element>::max();
+    const char *separators[] = {" ", "\t", "\r\n", "\n", " \t\r\n  "};
+    {
+        std::ofstream file(input, std::ios::binary);
+        for (size_t i = 0; i < data.size(); i++) {
+            file << (data[i] >= 0 && i % 7 == 0 ? "+" : "") << data[i];
+            file << (i + 1 < data.size() ? separators[i % 5] : "");
+        }
+    }
+    ASSERT_GT(std::filesystem::file_size(input), size_t{1} << 22);
+
+    // Reads of an odd size straddle both the chunks and the numbers cut by them
+    std::vector<Element> parsed(data.size() + 7);
+    size_t count = 0;
+    {
+        TextReader reader(input.c_str());
+        size_t got;
+        while ((got = reader.read(parsed.data() + count, 997)) == 997) {
+            count += got;
+        }
+        count += got;
+    }
+    parsed.resize(count);
+    EXPECT_EQ(parsed, data);
+
+    {
+        TextWriter writer(output.c_str());
+        writer.write(data.data(), data.data() + data.size() / 3);
+        writer.write(data.data() + data.size() / 3, data.data() + data.size());
+        writer.close();
+    }
+    EXPECT_EQ(read_text(output.c_str()), data);
+
+    // Only one sign
+    for (const char *text : {"1 +-5", "1 + 5", "++5"}) {
+        std::ofstream(input, std::ios::binary) << text;
+        EXPECT_THROW(read_text(input.c_str()), std::runtime_error) << text;
+    }
+    std::filesystem::remove(input);
+    std::filesystem::remove(output);
+}
+
+TEST(ExternalSort, Merge) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    auto directory = std::filesystem::temp_directory_path();
+    std::string input = (directory / "external-sort-input.txt").string();
+    std::string output = (directory / "external-sort-output.txt").string();
+    std::vector<Element> data(20'000);
+    if (rank == 0) {
+        auto gen = std::default_random_engine(4005);
+        auto dist = std::uniform_int_distribution<Element>{-100'000, 100'000};
+        for (auto &i : data) {
+            i = dist(gen);
+        }
+        write_text(input.c_str(), data.data(), data.data() + data.size());
+        std::sort(data.begin(), data.end());
+    }
+    // Too small next to the text buffers of both files
+    ExternalOptions options;
+    options.memory_limit = 96 << 10;
+    EXPECT_THROW(external_sort(*context, input.c_str(), output.c_str(), options), std::runtime_error);
+    // Barely enough: several chunks, and more runs than one merge pass takes
+    options.memory_limit = 128 << 10;
+    auto info = external_sort(*context, input.c_str(), output.c_str(), options);
+    EXPECT_EQ(context->buffers.bytes(), 0u);  // nothing kept from the chunks next to the merge
+    if (rank == 0) {
+        EXPECT_EQ(info->length, data.size());
+        EXPECT_EQ(read_text(output.c_str()), data);
+        std::filesystem::remove(input);
+        std::filesystem::remove(output);
+    }
+
+    // A missing input fails on all processes
+    std::string missing = (directory / "external-sort-missing").string();
+    EXPECT_THROW(external_sort(*context, missing.c_str(), output.c_str(), options), std::runtime_error);
+}
+
+TEST(BatchSort, Files) {
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    auto directory = std::filesystem::temp_directory_path();
+    std::vector<std::string> inputs;
+    std::vector<std::string> outputs;
+    std::vector<std::vector<Element>> expected;
+    if (rank == 0) {
+        // An empty file among them, text in and binary out
+        auto gen = std::default_random_engine(4005);
+        auto dist = std::uniform_int_distribution<Element>{-100'000, 100'000};
+        for (size_t length : {5'000, 0, 1, 30'000}) {
+            std::vector<Element> data(length);
+            for (auto &i : data) {
+                i = dist(gen);
+            }
+            inputs.push_back((directory / ("batch-sort-input-" + std::to_string(inputs.size()))).string());
+            outputs.push_back((directory / ("batch-sort-output-" + std::to_string(outputs.size()))).string());
+            write_text(inputs.back().c_str(), data.data(), data.data() + data.size());
+            std::sort(data.begin(), data.end());
+            expected.push_back(std::move(data));
+        }
+    }
+    BatchOptions options;
+    options.output_format = Format::Binary;
+    auto infos = batch_sort(*context, inputs, outputs, options);
+    if (rank == 0) {
+        ASSERT_EQ(infos.size(), inputs.size());
+        for (size_t i = 0; i < inputs.size(); i++) {
+            EXPECT_EQ(infos[i]->length, expected[i].size());
+            auto output = MappedArray::open(outputs[i].c_str());
+            EXPECT_EQ(std::vector<Element>(output.begin(), output.end()), expected[i]);
+            std::filesystem::remove(inputs[i]);
+            std::filesystem::remove(outputs[i]);
+        }
+    }
+
+    // A missing input fails on all processes
+    if (rank == 0) {
+        inputs = {(directory / "batch-sort-missing").string()};
+        outputs = {(directory / "batch-sort-missing-output").string()};
+    }
+    EXPECT_THROW(batch_sort(*context, inputs, outputs, options), std::runtime_error);
+}
+
 int main(int argc, char **argv) {
     context = std::make_unique<Context>(argc, argv);
     int rank;
@@ -0,0 +1,374 @@
+#include <text-io.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sort {
+    namespace {
+        constexpr size_t padding = 16;  // blanks after the data of a chunk, so scans need no bounds checks
+
+        struct Chunk {
+            std::vector<char> data;
+            size_t size = 0;
+        };
+
+        /** ChunkQueue
+         *  Hands chunks from one thread to another
+         */
+        class ChunkQueue {
+        public:
+            void push(std::unique_ptr<Chunk> chunk) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    chunks.push_back(std::move(chunk));
+                }
+                ready.notify_one();
+            }
+
+            /**!
+             * Wait for a chunk.
+             * @return the chunk, or null once the queue is closed and empty
+             */
+            std::unique_ptr<Chunk> pop() {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return !chunks.empty() || closed; });
+                if (chunks.empty()) {
+                    return nullptr;
+                }
+                auto chunk = std::move(chunks.front());
+                chunks.pop_front();
+                return chunk;
+            }
+
+            void close() {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    closed = true;
+                }
+                ready.notify_all();
+            }
+
+        private:
+            std::mutex mutex;
+            std::condition_variable ready;
+            std::deque<std::unique_ptr<Chunk>> chunks;
+            bool closed = false;
+        };
+
+        /**!
+         * Find the end of a token: the first byte that is a blank or a control character.
+         * The buffer must be followed by padding blanks.
+         * @param position start of the token
+         * @return the first byte after the token
+         */
+        inline const char *tokenEnd(const char *position) {
+#ifdef __SSE2__
+            const __m128i blank = _mm_set1_epi8(' ');
+            while (true) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(position));
+                // unsigned byte <= ' ' exactly when max(byte, ' ') == ' '
+                int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(bytes, blank), blank));
+                if (mask != 0) {
+                    return position + __builtin_ctz(mask);
+                }
+                position += 16;
+            }
+#else
+            while (static_cast<unsigned char>(*position) > ' ') {
+                ++position;
+            }
+            return position;
+#endif
+        }
+
+        inline bool isBlank(char c) {
+            return static_cast<unsigned char>(c) <= ' ';
+        }
+
+        std::runtime_error ioError(const std::string &what, const std::string &path) {
+            return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+        }
+    }
+
+    struct TextReader::State {
+        std::string path;
+        int fd = -1;
+        ChunkQueue filled;  // read by the background thread, waiting to be parsed
+        ChunkQueue empty;  // parsed, waiting to be filled again
+        std::thread reader;
+        std::exception_ptr error;
+
+        std::unique_ptr<Chunk> current;
+        size_t position = 0;
+        std::string carry;  // a number cut by the end of the previous chunk
+        bool finished = false;
+
+        void readLoop() {
+            try {
+                while (auto chunk = empty.pop()) {
+                    size_t capacity = chunk->data.size() - padding;
+                    chunk->size = 0;
+                    while (chunk->size < capacity) {
+                        ssize_t got = ::read(fd, chunk->data.data() + chunk->size, capacity - chunk->size);
+                        if (got < 0 && errno == EINTR) {
+                            continue;
+                        }
+                        if (got < 0) {
+                            throw ioError("failed to read", path);
+                        }
+                        if (got == 0) {
+                            break;
+                        }
+                        chunk->size += got;
+                    }
+                    std::memset(chunk->data.data() + chunk->size, ' ', padding);
+                    bool last = chunk->size < capacity;
+                    if (chunk->size > 0) {
+                        filled.push(std::move(chunk));
+                    }
+                    if (last) {
+                        break;
+                    }
+                }
+            } catch (...) {
+                error = std::current_exception();
+            }
+            filled.close();
+        }
+
+        /**!
+         * Move to the next chunk.
+         * @return false at the end of the file
+         */
+        bool advance() {
+            if (current) {
+                empty.push(std::move(current));
+            }
+            current = filled.pop();
+            position = 0;
+            if (!current) {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                return false;
+            }
+            return true;
+        }
+
+        void parse(const char *first, const char *last, Element &value) const {
+            // from_chars takes no plus sign, operator>> does: skip one that starts a number
+            const char *digits = first + (*first == '+' && last - first > 1 && first[1] != '-');
+            auto [end, code] = std::from_chars(digits, last, value);
+            if (code != std::errc() || end != last) {
+                throw std::runtime_error("invalid number \"" + std::string(first, last) + "\" in " + path);
+            }
+        }
+    };
+
+    TextReader::TextReader(const char *path, size_t chunkSize) : state(std::make_unique<State>()) {
+        state->path = path;
+        state->fd = ::open(path, O_RDONLY);
+        if (state->fd < 0) {
+            throw ioError("failed to open", path);
+        }
+        posix_fadvise(state->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        for (size_t i = 0; i < text_chunks_in_flight; i++) {
+            auto chunk = std::make_unique<Chunk>();
+            chunk->data.resize(chunkSize + padding);
+            state->empty.push(std::move(chunk));
+        }
+        state->reader = std::thread([s = state.get()] { s->readLoop(); });
+    }
+
+    TextReader::~TextReader() {
+        state->empty.close();
+        state->reader.join();
+        ::close(state->fd);
+    }
+
+    size_t TextReader::read(Element *output, size_t count) {
+        auto &s = *state;
+        size_t parsed = 0;
+        while (parsed < count && !s.finished) {
+            if (!s.current && !s.advance()) {
+                if (!s.carry.empty()) {  // the file ends with a number
+                    s.parse(s.carry.data(), s.carry.data() + s.carry.size(), output[parsed++]);
+                    s.carry.clear();
+                }
+                s.finished = true;
+                break;
+            }
+            const char *data = s.current->data.data();
+            const char *end = data + s.current->size;
+            const char *position = data + s.position;
+
+            if (!s.carry.empty()) {  // finish the number cut by the previous chunk
+                const char *last = tokenEnd(position);
+                s.carry.append(position, last);
+                if (last == end) {  // still not complete, the number spans the whole chunk
+                    s.advance();
+                    continue;
+                }
+                s.parse(s.carry.data(), s.carry.data() + s.carry.size(), output[parsed++]);
+                s.carry.clear();
+                position = last;
+            }
+
+            while (parsed < count) {
+                while (position < end && isBlank(*position)) {
+                    ++position;
+                }
+                if (position == end) {
+                    break;
+                }
+                const char *last = tokenEnd(position);
+                if (last == end) {  // may continue in the next chunk
+                    s.carry.assign(position, last);
+                    position = last;
+                    break;
+                }
+                s.parse(position, last, output[parsed++]);
+                position = last;
+            }
+
+            s.position = position - data;
+            if (position == end) {
+                s.advance();
+            }
+        }
+        return parsed;
+    }
+
+    char *format_text(const Element *begin, const Element *end, size_t first, char *output) {
+        for (auto i = begin; i != end; ++i) {
+            output = std::to_chars(output, output + max_number_length, *i).ptr;
+            *output++ = ' ';
+            if (++first % 20 == 0) {
+                *output++ = '\n';
+            }
+        }
+        return output;
+    }
+
+    void write_all(int fd, const void *data, size_t bytes, const char *path) {
+        auto position = static_cast<const char *>(data);
+        while (bytes > 0) {
+            ssize_t written = ::write(fd, position, bytes);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written < 0) {
+                throw ioError("failed to write", path);
+            }
+            position += written;
+            bytes -= written;
+        }
+    }
+
+    struct TextWriter::State {
+        std::string path;
+        int fd = -1;
+        size_t chunkSize = 0;
+        ChunkQueue filled;  // formatted, waiting to be written by the background thread
+        ChunkQueue empty;  // written, waiting to be filled again
+        std::thread writer;
+        std::exception_ptr error;
+        bool closed = false;
+
+        std::unique_ptr<Chunk> current;
+        size_t count = 0;  // numbers written so far, for the line breaks
+
+        void writeLoop() {
+            while (auto chunk = filled.pop()) {
+                if (!error) {
+                    try {
+                        write_all(fd, chunk->data.data(), chunk->size, path.c_str());
+                    } catch (...) {
+                        error = std::current_exception();
+                    }
+                }
+                chunk->size = 0;
+                empty.push(std::move(chunk));
+            }
+        }
+
+        void flush() {
+            if (current && current->size > 0) {
+                filled.push(std::move(current));
+            }
+        }
+    };
+
+    TextWriter::TextWriter(const char *path, size_t chunkSize) : state(std::make_unique<State>()) {
+        state->path = path;
+        state->chunkSize = chunkSize;
+        state->fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (state->fd < 0) {
+            throw ioError("failed to create", path);
+        }
+        for (size_t i = 0; i < text_chunks_in_flight; i++) {
+            auto chunk = std::make_unique<Chunk>();
+            chunk->data.resize(chunkSize + max_number_length);
+            state->empty.push(std::move(chunk));
+        }
+        state->writer = std::thread([s = state.get()] { s->writeLoop(); });
+    }
+
+    TextWriter::~TextWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+    void TextWriter::write(const Element *begin, const Element *end) {
+        auto &s = *state;
+        while (begin != end) {
+            if (!s.current) {
+                s.current = s.empty.pop();
+            }
+            // A chunk is flushed once it holds chunkSize bytes, there is always room for one more number
+            size_t room = (s.current->data.size() - s.current->size) / max_number_length;
+            size_t numbers = std::min<size_t>(room, end - begin);
+            char *output = s.current->data.data() + s.current->size;
+            s.current->size = format_text(begin, begin + numbers, s.count, output) - s.current->data.data();
+            s.count += numbers;
+            begin += numbers;
+            if (s.current->size >= s.chunkSize) {
+                s.flush();
+            }
+        }
+    }
+
+    void TextWriter::close() {
+        auto &s = *state;
+        if (s.closed) {
+            return;
+        }
+        s.closed = true;
+        s.flush();
+        s.filled.close();
+        s.writer.join();
+        if (::close(s.fd) != 0 && !s.error) {
+            s.error = std::make_exception_ptr(ioError("failed to close", s.path));
+        }
+        if (s.error) {
+            std::rethrow_exception(s.error);
+        }
+    }
+}
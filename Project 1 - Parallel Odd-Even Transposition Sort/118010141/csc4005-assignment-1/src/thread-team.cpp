@@ -0,0 +1,87 @@
+#include <thread-team.hpp>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sort {
+    struct ThreadTeam::State {
+        int size;
+        std::vector<std::thread> workers;
+        const std::function<void(int)> *task = nullptr;
+        std::atomic<uint64_t> generation{0};  // bumped for every task, the workers wait on it
+        std::atomic<int> pending{0};  // workers still running the current task
+        std::atomic<bool> stopping{false};
+        std::mutex errorMutex;
+        std::exception_ptr error;
+
+        void runTask(int id) {
+            try {
+                (*task)(id);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(errorMutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+
+        void workLoop(int id) {
+            uint64_t seen = 0;
+            while (true) {
+                generation.wait(seen, std::memory_order_acquire);
+                seen = generation.load(std::memory_order_acquire);
+                if (stopping.load(std::memory_order_acquire)) {
+                    return;
+                }
+                runTask(id);
+                if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    pending.notify_one();
+                }
+            }
+        }
+    };
+
+    ThreadTeam::ThreadTeam(int size) : state(std::make_unique<State>()) {
+        state->size = size < 1 ? 1 : size;
+        for (int id = 1; id < state->size; id++) {
+            state->workers.emplace_back([this, id] { state->workLoop(id); });
+        }
+    }
+
+    ThreadTeam::~ThreadTeam() {
+        state->stopping.store(true, std::memory_order_release);
+        state->generation.fetch_add(1, std::memory_order_acq_rel);
+        state->generation.notify_all();
+        for (auto &worker : state->workers) {
+            worker.join();
+        }
+    }
+
+    int ThreadTeam::size() const {
+        return state->size;
+    }
+
+    void ThreadTeam::run(const std::function<void(int)> &task) {
+        state->task = &task;
+        state->error = nullptr;
+        state->pending.store(state->size - 1, std::memory_order_release);
+        state->generation.fetch_add(1, std::memory_order_acq_rel);
+        state->generation.notify_all();
+
+        state->runTask(0);
+
+        int left;
+        while ((left = state->pending.load(std::memory_order_acquire)) != 0) {
+            state->pending.wait(left, std::memory_order_acquire);
+        }
+        if (state->error) {
+            std::rethrow_exception(state->error);
+        }
+    }
+
+    size_t ThreadTeam::first(int id, size_t count) const {
+        return id * count / state->size;
+    }
+}
@@ -0,0 +1,114 @@
+#include <workload.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace sort {
+    namespace {
+        constexpr uint64_t keyRange = 2147483647;  // RAND_MAX of glibc, the range of generateNum
+        constexpr double zipfExponent = 1.2;
+
+        /**!
+         * SplitMix64 finalizer: a well mixed 64-bit hash of a counter.
+         * @param value the counter
+         * @return the hash
+         */
+        inline uint64_t mix(uint64_t value) {
+            value += 0x9E3779B97F4A7C15ull;
+            value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+            value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+            return value ^ (value >> 31);
+        }
+
+        /**!
+         * A uniform double in (0, 1) from 32 random bits.
+         */
+        inline double unit(uint64_t bits) {
+            return (static_cast<double>(bits & 0xFFFFFFFFull) + 0.5) / 4294967296.0;
+        }
+
+        /**!
+         * Invert the continuous Zipf distribution over [1, keyRange): the density k^-s
+         * has the CDF (k^(1 - s) - 1) / (N^(1 - s) - 1).
+         * @param u uniform in (0, 1)
+         * @return the key
+         */
+        inline Element zipfKey(double u) {
+            static const double scale = std::pow(static_cast<double>(keyRange), 1 - zipfExponent) - 1;
+            double key = std::pow(u * scale + 1, 1 / (1 - zipfExponent));
+            return std::min(static_cast<Element>(key), static_cast<Element>(keyRange - 1));
+        }
+
+        /**!
+         * Box-Muller: a standard normal value from two uniform ones.
+         */
+        inline double normal(double u, double v) {
+            return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * v);
+        }
+    }
+
+    const char *distribution_name(Distribution distribution) {
+        switch (distribution) {
+            case Distribution::Uniform:
+                return "uniform";
+            case Distribution::Sorted:
+                return "sorted";
+            case Distribution::Reversed:
+                return "reversed";
+            case Distribution::NearlySorted:
+                return "nearly-sorted";
+            case Distribution::FewUnique:
+                return "few-unique";
+            case Distribution::Zipf:
+                return "zipf";
+            case Distribution::Gaussian:
+                return "gaussian";
+        }
+        return "unknown";
+    }
+
+    bool parse_distribution(const char *name, Distribution &distribution) {
+        for (auto candidate : {Distribution::Uniform, Distribution::Sorted, Distribution::Reversed,
+                               Distribution::NearlySorted, Distribution::FewUnique, Distribution::Zipf,
+                               Distribution::Gaussian}) {
+            if (std::strcmp(name, distribution_name(candidate)) == 0) {
+                distribution = candidate;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void generate(Distribution distribution, uint64_t seed, size_t count, size_t first, Element *begin, Element *end) {
+        uint64_t stream = mix(seed);
+        for (size_t i = first; begin != end; ++begin, ++i) {
+            uint64_t random = mix(stream ^ i);
+            switch (distribution) {
+                case Distribution::Uniform:
+                    *begin = static_cast<Element>(random % keyRange);
+                    break;
+                case Distribution::Sorted:
+                    *begin = static_cast<Element>(i);
+                    break;
+                case Distribution::Reversed:
+                    *begin = static_cast<Element>(count - i);
+                    break;
+                case Distribution::NearlySorted:
+                    // one key in 100 moves up to 64 places either way
+                    *begin = static_cast<Element>(i) + (random % 100 == 0 ? static_cast<Element>(random >> 32) % 129 - 64 : 0);
+                    break;
+                case Distribution::FewUnique:
+                    *begin = static_cast<Element>(random % 16);
+                    break;
+                case Distribution::Zipf:
+                    *begin = zipfKey(unit(random));
+                    break;
+                case Distribution::Gaussian: {
+                    double key = (keyRange + 1) / 2 + normal(unit(random), unit(random >> 32)) * (1 << 27);
+                    *begin = static_cast<Element>(std::clamp(key, 0.0, static_cast<double>(keyRange - 1)));
+                    break;
+                }
+            }
+        }
+    }
+}